@@ -0,0 +1,508 @@
+/**
+ * \file bench.c
+ *
+ * Throughput benchmarks for the library.
+ *
+ * + mt: the Mersenne Twister, a word at a time, in bulk, and through frng(),
+ *   against the byte-per-draw generator frng() used to be; and the time to
+ *   set up substreams by jumping ahead.
+ * + handshake: the server's share of a handshake (a decryption, two tokens
+ *   drawn and encrypted), with tokens drawn as bn_rng() used to (a fresh
+ *   /dev/urandom stream and srng() per call) and as it does now; and, from a
+ *   pool filled beforehand, the burst a pool can absorb.
+ * + drbg: srng() as it used to be, against the bunny24-CTR DRBG, in bulk and
+ *   a token at a time.
+ * + rsa: the private-key operation through BIGNUM alone, against
+ *   rsa_encrypt() (native up to 64 bits, fixed windows at 512), the CRT form,
+ *   and cached keys.
+ * + prng: primes of 128, 256 and 512 bits (for 256-, 512- and 1024-bit RSA
+ *   moduli), drawn afresh per candidate as prng() used to, and by sieving.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <openssl/bn.h>
+
+#include "bunny24.h"
+#include "fsock.h"
+#include "pool.h"
+#include "rng.h"
+#include "rsa.h"
+
+#define MIB (1 << 20)
+
+
+void usage(void)
+{
+  fprintf(stderr,
+          "Usage: ./bench mt [MiB]\n"
+          "       ./bench handshake [count]\n"
+          "       ./bench drbg [MiB]\n"
+          "       ./bench prng [count]\n"
+          "       ./bench rsa [count]\n");
+  exit(EXIT_FAILURE);
+}
+
+static double elapsed(const struct timespec* start)
+{
+  struct timespec end;
+
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static void report(const char* what, size_t bytes, double secs)
+{
+  printf("  %-40s %8.3f GB/s\n", what, bytes / secs / 1e9);
+}
+
+static void report_mb(const char* what, size_t bytes, double secs)
+{
+  printf("  %-40s %8.1f MB/s\n", what, bytes / secs / 1e6);
+}
+
+
+/*
+ * +------------------+
+ * | Mersenne Twister |
+ * +------------------+
+ */
+
+/*
+ * The generator frng() used to run, as it was: a single global state of
+ * signed words, its own seeding and twist with modulo indexing, and one
+ * tempered word per output byte.
+ */
+static int legacy_mt[624];
+static int legacy_index;
+
+static void legacy_init(int seed)
+{
+  size_t i;
+
+  legacy_index = 0;
+  legacy_mt[0] = seed;
+  for (i=1; i!=624; i++)
+    legacy_mt[i] = 0xffff & (0x6c078965 * (legacy_mt[i-1] ^ ((legacy_mt[i-1] >> 30) + i)));
+}
+
+static int legacy_next(void)
+{
+  size_t i;
+  int y;
+
+  if (legacy_index == 0)
+    for (i=0; i!=624; i++) {
+      y = (legacy_mt[i] ^ 0x80000000) + (legacy_mt[(i+1) % 624] & 0x7fffffff);
+      legacy_mt[i] = legacy_mt[(i + 397) % 624] ^ (y >> 1);
+      if (y % 2) legacy_mt[i] ^= 0x9908b0df;
+    }
+  y = legacy_mt[legacy_index];
+  y ^= (y >> 11);
+  y ^= (y << 7) & 0x9d2c5680;
+  y ^= (y << 15) & 0xefc60000;
+  y ^= (y >> 18);
+  legacy_index = (legacy_index+1) % 624;
+  return y;
+}
+
+static int mt(int argc, char** argv)
+{
+  struct mt_ctx ctx, subs[8];
+  struct timespec start;
+  unsigned char* buf;
+  uint32_t* words;
+  size_t total, done, i;
+  uint32_t sink;
+  double secs;
+
+  total = (argc > 2 ? strtoul(argv[2], NULL, 0) : 256) * (size_t) MIB;
+  if (!total) usage();
+  buf = malloc(MIB);
+  words = (uint32_t*) buf;
+  mt_init(&ctx, 5489);
+  printf("[+] %zu MiB per generator\n", total / MIB);
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  legacy_init(5489);
+  for (done=0; done < total/16; done += MIB)
+    for (i=0; i!=MIB; i++)
+      buf[i] = legacy_next();
+  report("old frng(), a byte per word", done, elapsed(&start));
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (sink=done=0; done != total; done += 4)
+    sink ^= mt_next(&ctx);
+  secs = elapsed(&start);
+  report("mt_next(), a word at a time", total, secs);
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (done=0; done != total; done += MIB)
+    mt_fill32(&ctx, words, MIB/4);
+  report("mt_fill32(), 1 MiB at a time", total, elapsed(&start));
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (done=0; done != total; done += MIB)
+    mt_fill(&ctx, buf, MIB);
+  report("mt_fill(), 1 MiB at a time", total, elapsed(&start));
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (done=0; done < total/16; done += 4096)
+    frng((char*) buf, "seed", 4096);
+  report("frng(), 4 KiB per call, reseeding", done, elapsed(&start));
+
+  /* the first jump by 2^k also finds its polynomial */
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  mt_jump(&ctx, 64);
+  printf("  %-40s %8.3f ms\n", "first mt_jump() by 2^64", elapsed(&start) * 1e3);
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  mt_substreams(subs, 8, 5489, 64);
+  printf("  %-40s %8.3f ms\n", "8 substreams, 2^64 apart", elapsed(&start) * 1e3);
+
+  fprintf(stderr, "[+] %08x\n", sink ^ words[0] ^ buf[0] ^ mt_next(&subs[7]));
+  free(buf);
+  return EXIT_SUCCESS;
+}
+
+
+/*
+ * +-----------+
+ * | Handshake |
+ * +-----------+
+ */
+
+/* server_folder/server_rsa64_private_key.txt, and Pippo's public key */
+#define SRV_N "794D23A3CED5E8D9"
+#define SRV_D "29FA856A90E2EC57"
+#define CLI_N "79F874B5F8BABE85"
+#define CLI_E "10003"
+
+/* srng() as it was: bunny24-CBC over zeros, a multiple of 3 bytes */
+static char* legacy_srng(char* dest, const char* seed, size_t len)
+{
+  char iv[3] = {0};
+
+  iv[0] = seed[3];
+  memset(dest, 0, len);
+  bunny24_cbc_encrypt(dest, iv, seed, dest, len);
+  return dest;
+}
+
+/* bn_rng() as it was: a file opened and read per call */
+static BIGNUM* legacy_bn_rng(BIGNUM** p, int bits)
+{
+  int i, bytes_units;
+  char seed[4];
+  FILE* fp = fopen("/dev/urandom", "r");
+  unsigned char* buf;
+
+  if (!*p) *p = BN_new();
+  bytes_units = bits / 8;
+  bytes_units += 3 - bytes_units % 3;
+  buf = malloc(bytes_units);
+  do {
+    for (i=0; i!=4; i++) seed[i] = fgetc(fp);
+    legacy_srng((char*) buf, seed, bytes_units);
+    BN_bin2bn(buf, bytes_units, *p);
+  } while (BN_is_zero(*p) || BN_is_one(*p));
+  fclose(fp);
+  free(buf);
+  return *p;
+}
+
+static double run_handshakes(BIGNUM* (*rng)(BIGNUM**, int), size_t count)
+{
+  BIGNUM *srv_n = NULL, *srv_d = NULL, *cli_n = NULL, *cli_e = NULL;
+  BIGNUM *c = BN_new(), *r = NULL, *k = NULL;
+  struct timespec start;
+  size_t i;
+  double secs;
+
+  BN_hex2bn(&srv_n, SRV_N);
+  BN_hex2bn(&srv_d, SRV_D);
+  BN_hex2bn(&cli_n, CLI_N);
+  BN_hex2bn(&cli_e, CLI_E);
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (i=0; i!=count; i++) {
+    BN_set_word(c, i + 2);
+    rsa_decrypt(c, srv_d, srv_n);
+    rng(&r, RND_TOKEN_SIZE);
+    BN_copy(c, r);
+    rsa_encrypt(c, cli_e, cli_n);
+    rng(&k, RND_TOKEN_SIZE);
+    BN_copy(c, k);
+    rsa_encrypt(c, cli_e, cli_n);
+  }
+  secs = elapsed(&start);
+
+  BN_free(srv_n);
+  BN_free(srv_d);
+  BN_free(cli_n);
+  BN_free(cli_e);
+  BN_free(c);
+  BN_free(r);
+  BN_free(k);
+  return count / secs;
+}
+
+/*
+ * The same, popping from a pool filled beforehand and twice as large: a burst
+ * it absorbs without refilling.
+ */
+static double run_pooled(size_t count)
+{
+  BIGNUM *srv_n = NULL, *srv_d = NULL, *cli_n = NULL, *cli_e = NULL;
+  BIGNUM *c = BN_new(), *r = NULL, *k = NULL;
+  struct timespec start;
+  struct pool* pool;
+  size_t i;
+  double secs;
+
+  BN_hex2bn(&srv_n, SRV_N);
+  BN_hex2bn(&srv_d, SRV_D);
+  BN_hex2bn(&cli_n, CLI_N);
+  BN_hex2bn(&cli_e, CLI_E);
+  pool = pool_new(RND_TOKEN_SIZE, 2*count, 1);
+  pool_add_client(pool, "Pippo", cli_e, cli_n);
+  pool_wait(pool);
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (i=0; i!=count; i++) {
+    BN_set_word(c, i + 2);
+    rsa_decrypt(c, srv_d, srv_n);
+    pool_challenge(pool, "Pippo", RND_TOKEN_SIZE, cli_e, cli_n, &r, &c);
+    pool_token(pool, &k, RND_TOKEN_SIZE);
+    BN_copy(c, k);
+    rsa_encrypt(c, cli_e, cli_n);
+  }
+  secs = elapsed(&start);
+
+  pool_free(pool);
+  BN_free(srv_n);
+  BN_free(srv_d);
+  BN_free(cli_n);
+  BN_free(cli_e);
+  BN_free(c);
+  BN_free(r);
+  BN_free(k);
+  return count / secs;
+}
+
+static double run_tokens(BIGNUM* (*rng)(BIGNUM**, int), size_t count)
+{
+  struct timespec start;
+  BIGNUM* r = NULL;
+  size_t i;
+  double secs;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (i=0; i!=count; i++)
+    rng(&r, RND_TOKEN_SIZE);
+  secs = elapsed(&start);
+  BN_free(r);
+  return count / secs;
+}
+
+static int handshake(int argc, char** argv)
+{
+  size_t count;
+
+  count = argc > 2 ? strtoul(argv[2], NULL, 0) : 100000;
+  if (!count) usage();
+  printf("[+] %zu handshakes, server side\n", count);
+  printf("  %-40s %10.0f /s\n", "handshakes, old bn_rng()",
+         run_handshakes(legacy_bn_rng, count));
+  printf("  %-40s %10.0f /s\n", "handshakes, bn_rng()",
+         run_handshakes(bn_rng, count));
+  printf("  %-40s %10.0f /s\n", "handshakes, burst from a full pool",
+         run_pooled(count));
+  printf("  %-40s %10.0f /s\n", "tokens alone, old bn_rng()",
+         run_tokens(legacy_bn_rng, count));
+  printf("  %-40s %10.0f /s\n", "tokens alone, bn_rng()",
+         run_tokens(bn_rng, count));
+  return EXIT_SUCCESS;
+}
+
+
+/*
+ * +------+
+ * | DRBG |
+ * +------+
+ */
+
+static int drbg(int argc, char** argv)
+{
+  struct drbg_ctx ctx;
+  struct timespec start;
+  unsigned char* buf;
+  size_t total, done;
+
+  total = (argc > 2 ? strtoul(argv[2], NULL, 0) : 16) * (size_t) MIB;
+  if (!total) usage();
+  buf = malloc(MIB);
+  printf("[+] %zu MiB per generator\n", total / MIB);
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (done=0; done < total/64; done += 3*1366)
+    legacy_srng((char*) buf, "seed", 3*1366);
+  report_mb("old srng(), 4 KiB per call", done, elapsed(&start));
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (done=0; done != total; done += 4096)
+    srng((char*) buf, "seed", 4096);
+  report_mb("srng(), 4 KiB per call", total, elapsed(&start));
+
+  drbg_init(&ctx);
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (done=0; done != total; done += MIB)
+    drbg_generate(&ctx, buf, MIB);
+  report_mb("drbg_generate(), 1 MiB at a time", total, elapsed(&start));
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (done=0; done != total; done += 16)
+    drbg_generate(&ctx, buf, 16);
+  report_mb("drbg_generate(), 16 bytes at a time", total, elapsed(&start));
+
+  free(buf);
+  return EXIT_SUCCESS;
+}
+
+
+/*
+ * +--------------+
+ * | Prime Search |
+ * +--------------+
+ */
+
+/* prng() as it was: a fresh random number, made odd, per candidate */
+static BIGNUM* legacy_prng(BIGNUM** p, int bits)
+{
+  do {
+    bn_rng(p, bits);
+    if (!BN_is_odd(*p)) BN_add(*p, *p, BN_value_one());
+  } while (!BN_is_prime(*p, 10, NULL, NULL, NULL));
+  return *p;
+}
+
+static double run_primes(BIGNUM* (*gen)(BIGNUM**, int), int bits, size_t count)
+{
+  struct timespec start;
+  BIGNUM* p = NULL;
+  size_t i;
+  double secs;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (i=0; i!=count; i++)
+    gen(&p, bits);
+  secs = elapsed(&start);
+  BN_free(p);
+  return secs / count * 1e3;
+}
+
+static int primes(int argc, char** argv)
+{
+  static const int sizes[] = {128, 256, 512};
+  char what[64];
+  size_t count, s;
+
+  count = argc > 2 ? strtoul(argv[2], NULL, 0) : 50;
+  if (!count) usage();
+  printf("[+] %zu primes per size\n", count);
+  for (s=0; s!=sizeof(sizes)/sizeof(sizes[0]); s++) {
+    snprintf(what, sizeof(what), "old prng(), %d bits", sizes[s]);
+    printf("  %-40s %8.3f ms\n", what, run_primes(legacy_prng, sizes[s], count));
+    snprintf(what, sizeof(what), "prng(), %d bits", sizes[s]);
+    printf("  %-40s %8.3f ms\n", what, run_primes(prng, sizes[s], count));
+  }
+  return EXIT_SUCCESS;
+}
+
+
+/*
+ * +-----+
+ * | RSA |
+ * +-----+
+ */
+
+/* rsa_encrypt() as it was: BIGNUM only, with a BN_CTX per call */
+static void legacy_rsa_encrypt(BIGNUM* m, const BIGNUM* e, const BIGNUM* n)
+{
+  BN_CTX* ctx = BN_CTX_new();
+  BIGNUM* tmp = BN_dup(m);
+
+  BN_mod_exp(m, tmp, e, n, ctx);
+  BN_free(tmp);
+  BN_CTX_free(ctx);
+}
+
+static int rsa(int argc, char** argv)
+{
+  static const int sizes[] = {64, 512, 1024, 2048};
+  static const char* how[] = {
+    "d, BIGNUM", "d", "CRT", "d, cached key", "CRT, cached key"
+  };
+  BIGNUM *n = BN_new(), *phi = BN_new(), *e = BN_new(), *d = BN_new();
+  BIGNUM *c = BN_new(), *m = BN_new();
+  struct rsa_crt* crt;
+  struct rsa_key_ctx *plain_key, *crt_key;
+  struct timespec start;
+  double base = 0, t;
+  size_t count, s, i;
+  int v;
+  char what[64];
+
+  count = argc > 2 ? strtoul(argv[2], NULL, 0) : 1000;
+  if (!count) usage();
+  printf("[+] %zu private-key operations per size\n", count);
+  for (s=0; s!=sizeof(sizes)/sizeof(sizes[0]); s++) {
+    rsa_genkey_parallel(1, sizes[s], n, phi, e, d, &crt);
+    BN_rand_range(c, n);
+    plain_key = rsa_key_new(d, n, NULL);
+    crt_key = rsa_key_new(d, n, crt);
+
+    for (v=0; v!=5; v++) {
+      clock_gettime(CLOCK_MONOTONIC, &start);
+      for (i=0; i!=count; i++) {
+        BN_copy(m, c);
+        switch (v) {
+        case 0: legacy_rsa_encrypt(m, d, n); break;
+        case 1: rsa_decrypt(m, d, n); break;
+        case 2: rsa_crt_decrypt(m, crt); break;
+        case 3: rsa_key_exp(m, plain_key); break;
+        case 4: rsa_key_exp(m, crt_key); break;
+        }
+      }
+      t = elapsed(&start) / count;
+      if (!v) base = t;
+      snprintf(what, sizeof(what), "RSA%d, %s (%.1fx)", sizes[s], how[v], base / t);
+      printf("  %-40s %8.1f us\n", what, t * 1e6);
+    }
+    /* crt belongs to crt_key */
+    rsa_key_free(plain_key);
+    rsa_key_free(crt_key);
+  }
+
+  BN_free(n);
+  BN_free(phi);
+  BN_free(e);
+  BN_free(d);
+  BN_free(c);
+  BN_free(m);
+  return EXIT_SUCCESS;
+}
+
+int main(int argc, char** argv)
+{
+  if (argc < 2) usage();
+  if (!strcmp(argv[1], "mt")) return mt(argc, argv);
+  if (!strcmp(argv[1], "handshake")) return handshake(argc, argv);
+  if (!strcmp(argv[1], "drbg")) return drbg(argc, argv);
+  if (!strcmp(argv[1], "prng")) return primes(argc, argv);
+  if (!strcmp(argv[1], "rsa")) return rsa(argc, argv);
+  usage();
+  return EXIT_FAILURE;
+}
@@ -50,6 +50,8 @@ int main(int argc, char **argv)
     *r1 = NULL,
     *c,
     *k = NULL;
+  struct rsa_crt *cli_crt;
+  struct rsa_key_ctx *srv_key, *cli_key;
   /* file descriptors */
   int rfd, wfd;
   /* cipehrsuites */
@@ -69,8 +71,10 @@ int main(int argc, char **argv)
 
   /* GET public rsa key of S, (s_puk,n) */
   read_bn_pair(SRV_PUBKEY_FILE, &srv_rsa_n, &srv_rsa_e);
+  if (!(srv_key = rsa_key_new(srv_rsa_e, srv_rsa_n, NULL))) sabort();
   /* GET private rsa key of C, (s_prk,n) */
-  read_bn_pair(CLI_PRIVKEY64_FILE, &cli_rsa_n, &cli_rsa_d);
+  read_rsa_key(CLI_PRIVKEY64_FILE, &cli_rsa_n, &cli_rsa_d, &cli_crt);
+  if (!(cli_key = rsa_key_new(cli_rsa_d, cli_rsa_n, cli_crt))) sabort();
   /* GET my cipher suite from file */
   fcipher = fopen(CIPHERSUITE_FILE, "r");
   ciphersuite = fgetc(fcipher);
@@ -90,7 +94,7 @@ int main(int argc, char **argv)
   bn_rng(&r, RND_TOKEN_SIZE);
   /* ENCRYPT r using (s_puk,n) -> c = r^s_puk mod n */
   c = BN_dup(r);
-  rsa_encrypt(c, srv_rsa_e, srv_rsa_n);
+  rsa_key_exp(c, srv_key);
 
   /* WRITE c to S */
   swrite_bn(c, wfd);
@@ -108,18 +112,21 @@ int main(int argc, char **argv)
   swrite(client_name, strlen(client_name), wfd);
   sread_bn(&c, rfd);
   /* READ c from S */
-  rsa_decrypt(c, cli_rsa_d, cli_rsa_n);
+  rsa_key_exp(c, cli_key);
   swrite_bn(c, wfd);
 
   /** CIPHERSUITE NEGOTIATION **/
   /* SEND my cipher suite to server */
   swrite(&ciphersuite, 1, wfd);
   /* GET private key file (if any) */
-  if (asymm_cipher == 6)
-    read_bn_pair(CLI_PRIVKEY512_FILE, &cli_rsa_n, &cli_rsa_d);
+  if (asymm_cipher == 6) {
+    rsa_key_free(cli_key);
+    read_rsa_key(CLI_PRIVKEY512_FILE, &cli_rsa_n, &cli_rsa_d, &cli_crt);
+    if (!(cli_key = rsa_key_new(cli_rsa_d, cli_rsa_n, cli_crt))) sabort();
+  }
   /* compute k from h and my private key */
   sread_bn(&k, rfd);
-  rsa_decrypt(k, cli_rsa_d, cli_rsa_n);
+  rsa_key_exp(k, cli_key);
   BN_bn2bin(k, (unsigned char *) key);
   /* GET message from file */
   message_size = get_message(message);
@@ -141,6 +148,8 @@ int main(int argc, char **argv)
   BN_free(r);
   BN_free(c);
   BN_free(r1);
+  rsa_key_free(srv_key);
+  rsa_key_free(cli_key);
 
   sclose(rfd);
   sclose(wfd);
@@ -0,0 +1,418 @@
+/**
+ * \file corrattack.c
+ *
+ * Correlation attack on \ref all5().
+ *
+ * The five registers of ALL5 are clocked regularly and combined by a fixed
+ * Boolean function f. Its Walsh spectrum, computed by a fast Walsh–Hadamard
+ * transform, tells which linear combinations of the register outputs the
+ * keystream is correlated to: each of them can be attacked on its own, trying
+ * all the states of just the registers involved and keeping the one whose
+ * output agrees the most with the keystream (divide and conquer).
+ *
+ * Candidates are enumerated in Gray code order, so that the output sequence of
+ * the next one is a single xor away, and agreements are counted 64 bits at a
+ * time; worker threads split the candidates among them.
+ */
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bm.h"
+#include "lfsr.h"
+
+#define CHUNK (1 << 16)
+
+
+/** A linear combination of the register outputs, correlated to f. */
+struct target {
+  unsigned mask;
+  int walsh;
+  size_t size;
+};
+
+struct attack {
+  /* output sequences of the unit states, size rows of stride words */
+  const uint64_t* basis;
+  const uint64_t* keystream;
+  size_t size, words, stride, n;
+  /* the candidate bits of each register involved */
+  uint64_t parts[5];
+  size_t nparts;
+  int sign;
+  uint64_t total;
+  uint64_t next;
+
+  pthread_mutex_t lock;
+  uint64_t best;
+  long score, second;
+};
+
+
+void usage(void)
+{
+  fprintf(stderr,
+          "Usage: ./corrattack [-s seed] [-j threads] [-m max bits] [-n bits]\n");
+  exit(EXIT_FAILURE);
+}
+
+static double elapsed(const struct timespec* start)
+{
+  struct timespec end;
+
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+
+/*
+ * +-----------------+
+ * | Walsh Spectrum  |
+ * +-----------------+
+ */
+
+/** The combining function of \ref all5(), bit j of x being x_(j+1). */
+static int combine(unsigned x)
+{
+  int b[5], j;
+
+  for (j=0; j!=5; j++)
+    b[j] = x >> j & 1;
+  return (b[0]&b[3]) ^ (b[1]&b[2]) ^ (b[1]&b[4]) ^ (b[2]&b[3]);
+}
+
+/**
+ * \brief Fast Walsh–Hadamard transform, in place, of n = 2^k values.
+ *
+ * Starting from w[x] = (-1)^f(x), leaves W(a) = Σₓ (-1)^(f(x) + a·x) in w[a].
+ */
+static void fwht(int* w, size_t n)
+{
+  size_t h, i, j;
+  int u, v;
+
+  for (h=1; h!=n; h*=2)
+    for (i=0; i!=n; i+=2*h)
+      for (j=i; j!=i+h; j++) {
+        u = w[j];
+        v = w[j+h];
+        w[j] = u + v;
+        w[j+h] = u - v;
+      }
+}
+
+static void print_mask(unsigned mask)
+{
+  int j, first;
+
+  for (first=1, j=0; j!=5; j++)
+    if (mask >> j & 1) {
+      printf("%sx%d", first ? "" : " + ", j+1);
+      first = 0;
+    }
+}
+
+/**
+ * \brief Prints the spectrum of f and the figures derived from it.
+ *
+ * \param[out] w the Walsh spectrum, of 32 values.
+ */
+static void spectrum(int* w)
+{
+  int anf[32];
+  size_t h, i, j;
+  unsigned a;
+  int weight, degree, nonlinearity, immunity, max;
+
+  for (a=weight=0; a!=32; a++) {
+    anf[a] = combine(a);
+    weight += anf[a];
+    w[a] = anf[a] ? -1 : 1;
+  }
+  fwht(w, 32);
+
+  /* Möbius transform: the algebraic normal form of f */
+  for (h=1; h!=32; h*=2)
+    for (i=0; i!=32; i+=2*h)
+      for (j=i; j!=i+h; j++)
+        anf[j+h] ^= anf[j];
+  for (a=degree=0; a!=32; a++)
+    if (anf[a] && __builtin_popcount(a) > degree) degree = __builtin_popcount(a);
+
+  for (a=max=0; a!=32; a++)
+    if (abs(w[a]) > max) max = abs(w[a]);
+  nonlinearity = 16 - max/2;
+
+  /* largest m with W(a) = 0 for all 1 ≤ wt(a) ≤ m */
+  for (immunity=0; immunity!=5; immunity++) {
+    for (a=1; a!=32; a++)
+      if (__builtin_popcount(a) == immunity+1 && w[a]) break;
+    if (a != 32) break;
+  }
+
+  printf("[+] f = x1x4 + x2x3 + x2x5 + x3x4\n");
+  printf("[+] weight %d/32 (%sbalanced), algebraic degree %d, nonlinearity %d\n",
+         weight, w[0] ? "un" : "", degree, nonlinearity);
+  printf("[+] correlation immune of order %d\n", immunity);
+  printf("[+] non-zero Walsh coefficients:\n");
+  for (a=1; a!=32; a++)
+    if (w[a]) {
+      printf("  W = %+3d, c = %+.3f: ", w[a], w[a] / 32.0);
+      print_mask(a);
+      printf("\n");
+    }
+}
+
+
+/*
+ * +-------------+
+ * | The Attack  |
+ * +-------------+
+ */
+
+/**
+ * \brief Correlation of the candidates in [lo, hi) of the Gray code.
+ *
+ * acc holds the keystream xored with the output of the current candidate:
+ * moving to the next one flips a single bit of the state, and a single row
+ * of the basis is xored in.
+ */
+__attribute__((target_clones("popcnt", "default")))
+static void scan(struct attack* at, uint64_t* acc, uint64_t lo, uint64_t hi,
+                 uint64_t* best, long* score, long* second)
+{
+  const uint64_t* row;
+  uint64_t g, i;
+  size_t k, p;
+  long s, diff;
+
+  g = lo ^ lo >> 1;
+  memcpy(acc, at->keystream, at->words * sizeof(uint64_t));
+  for (k=0; k!=at->size; k++)
+    if (g >> k & 1)
+      for (row = at->basis + k*at->stride, p=0; p!=at->words; p++)
+        acc[p] ^= row[p];
+
+  for (i=lo; i!=hi; i++) {
+    if (i != lo) {
+      k = __builtin_ctzll(i);
+      g ^= (uint64_t) 1 << k;
+      for (row = at->basis + k*at->stride, p=0; p!=at->words; p++)
+        acc[p] ^= row[p];
+    }
+    /* registers are never all zero, and the keystream is biased */
+    for (p=0; p!=at->nparts && (g & at->parts[p]); p++) ;
+    if (p != at->nparts) continue;
+
+    for (diff=p=0; p!=at->words; p++)
+      diff += __builtin_popcountll(acc[p]);
+    s = at->sign * ((long) at->n - 2*diff);
+    if (s > *score) {
+      *second = *score;
+      *score = s;
+      *best = g;
+    } else if (s > *second)
+      *second = s;
+  }
+}
+
+static void* worker(void* arg)
+{
+  struct attack* at = arg;
+  uint64_t* acc;
+  uint64_t lo, best;
+  long score, second;
+
+  acc = malloc(at->words * sizeof(uint64_t));
+  best = 0;
+  score = second = -(long) at->n - 1;
+  while ((lo = __atomic_fetch_add(&at->next, CHUNK, __ATOMIC_RELAXED)) < at->total)
+    scan(at, acc, lo, lo + CHUNK < at->total ? lo + CHUNK : at->total,
+         &best, &score, &second);
+  free(acc);
+
+  pthread_mutex_lock(&at->lock);
+  if (score > at->score) {
+    at->second = at->score > second ? at->score : second;
+    at->score = score;
+    at->best = best;
+  } else if (score > at->second)
+    at->second = score;
+  pthread_mutex_unlock(&at->lock);
+  return NULL;
+}
+
+/**
+ * \brief Keystream bits needed to single out the right candidate.
+ *
+ * The correlation of a wrong candidate is about normal, with mean 0 and
+ * deviation √n; the right one stands at c·n, which must clear the largest of
+ * 2^size wrong ones, √(2·size·ln 2)·√n, with some margin.
+ */
+static size_t bits_needed(size_t size, int walsh)
+{
+  double c = abs(walsh) / 32.0;
+  double n = pow((sqrt(2 * size * log(2)) + 3) / c, 2);
+
+  return 64 * (size_t) ceil(n / 64);
+}
+
+/**
+ * \brief Recovers the states of the registers in t.mask.
+ *
+ * \param keystream n bits of keystream, packed as in \ref pack_bits().
+ * \param states the actual states, to check the result against.
+ *
+ * \return the time taken, in seconds.
+ */
+static double attack(struct target t,
+                     const uint64_t* keystream,
+                     size_t n,
+                     const uint64_t* states,
+                     int threads)
+{
+  struct attack at;
+  struct timespec start;
+  pthread_t tid[threads];
+  uint64_t* basis;
+  uint64_t found;
+  size_t j, b, off;
+  double secs;
+  int i;
+
+  memset(&at, 0, sizeof(at));
+  at.size = t.size;
+  at.n = n;
+  at.words = n / 64;
+  at.stride = n/64 + 1;
+  at.sign = t.walsh > 0 ? 1 : -1;
+  at.total = (uint64_t) 1 << t.size;
+  at.keystream = keystream;
+  at.score = at.second = -(long) n - 1;
+  pthread_mutex_init(&at.lock, NULL);
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  basis = malloc(t.size * at.stride * sizeof(uint64_t));
+  for (off=j=0; j!=5; j++) {
+    if (!(t.mask >> j & 1)) continue;
+    for (b=0; b!=lfsr_degree(j); b++)
+      lfsr_output(basis + (off+b)*at.stride, j, (uint64_t) 1 << b, n);
+    at.parts[at.nparts++] = ((((uint64_t) 1 << lfsr_degree(j)) - 1)) << off;
+    off += lfsr_degree(j);
+  }
+  at.basis = basis;
+
+  for (i=0; i!=threads; i++)
+    if (pthread_create(&tid[i], NULL, worker, &at)) abort();
+  for (i=0; i!=threads; i++)
+    pthread_join(tid[i], NULL);
+  secs = elapsed(&start);
+
+  printf("[+] ");
+  print_mask(t.mask);
+  printf(": %zu bits, %lu candidates, %zu keystream bits\n",
+         t.size, (unsigned long) at.total, n);
+  for (off=j=0; j!=5; j++) {
+    if (!(t.mask >> j & 1)) continue;
+    found = at.best >> off & ((((uint64_t) 1 << lfsr_degree(j)) - 1));
+    printf("      x%zu = %#0*lx %s\n", j+1, (int) (lfsr_degree(j)+3)/4 + 2,
+           (unsigned long) found, found == states[j] ? "(correct)" : "(wrong)");
+    off += lfsr_degree(j);
+  }
+  printf("      correlation %+ld, runner-up %+ld, expected %+.0f; %.3f s\n",
+         at.score, at.second, t.walsh / 32.0 * n, secs);
+
+  free(basis);
+  pthread_mutex_destroy(&at.lock);
+  return secs;
+}
+
+static int by_size(const void* a, const void* b)
+{
+  const struct target* x = a;
+  const struct target* y = b;
+
+  return x->size != y->size ? (x->size > y->size) - (x->size < y->size)
+                            : (int) x->mask - (int) y->mask;
+}
+
+
+int main(int argc, char** argv)
+{
+  struct all5_ctx ctx;
+  struct target targets[31];
+  struct timespec start;
+  char key[64];
+  char* bits;
+  uint64_t* keystream;
+  size_t n, fixed, max, ntargets, i, j;
+  unsigned seed, a;
+  int w[32];
+  int opt, threads;
+  double secs;
+
+  seed = 1;
+  threads = sysconf(_SC_NPROCESSORS_ONLN);
+  max = 24;
+  fixed = 0;
+  while ((opt = getopt(argc, argv, "s:j:m:n:")) != -1)
+    switch (opt) {
+    case 's': seed = strtoul(optarg, NULL, 0); break;
+    case 'j': threads = atoi(optarg); break;
+    case 'm': max = strtoul(optarg, NULL, 0); break;
+    case 'n': fixed = 64 * ((strtoul(optarg, NULL, 0) + 63) / 64); break;
+    default: usage();
+    }
+  if (optind != argc || max > 40) usage();
+  if (threads < 1) threads = 1;
+
+  spectrum(w);
+
+  /* the combinations within reach, smaller first */
+  for (ntargets=0, a=1; a!=32; a++) {
+    if (!w[a]) continue;
+    targets[ntargets].mask = a;
+    targets[ntargets].walsh = w[a];
+    for (targets[ntargets].size=j=0; j!=5; j++)
+      if (a >> j & 1) targets[ntargets].size += lfsr_degree(j);
+    if (targets[ntargets].size <= max) ntargets++;
+  }
+  qsort(targets, ntargets, sizeof(struct target), by_size);
+  if (!ntargets) {
+    printf("[-] no combination of at most %zu bits\n", max);
+    return 1;
+  }
+
+  /* a random key, and enough keystream for every target */
+  srand(seed);
+  for (i=0; i!=64; i++)
+    key[i] = rand() & 1;
+  all5_init(&ctx, key);
+  for (n=fixed, i=0; !fixed && i!=ntargets; i++)
+    if (bits_needed(targets[i].size, targets[i].walsh) > n)
+      n = bits_needed(targets[i].size, targets[i].walsh);
+  bits = malloc(n);
+  keystream = malloc((n/64 + 1) * sizeof(uint64_t));
+  all5(bits, key, n);
+
+  printf("[+] %d threads\n", threads);
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (i=0; i!=ntargets; i++) {
+    pack_bits(keystream, bits,
+              fixed ? n : bits_needed(targets[i].size, targets[i].walsh));
+    attack(targets[i], keystream,
+           fixed ? n : bits_needed(targets[i].size, targets[i].walsh),
+           ctx.states, threads);
+  }
+  secs = elapsed(&start);
+  fprintf(stderr, "[+] %zu combinations in %.3f s\n", ntargets, secs);
+
+  free(keystream);
+  free(bits);
+  return 0;
+}
@@ -1,6 +1,7 @@
 #include "fsock.h"
 #include "lfsr.h"
 #include "bunny24.h"
+#include "rsa.h"
 
 #include <openssl/bn.h>
 
@@ -138,6 +139,38 @@ void read_bn_pair(const char *path,
   BN_hex2bn(b, snd);
 }
 
+/**
+ * \brief Reads a private key file, "N,D" or "N,D,P,Q,DP,DQ,QINV" in hex.
+ *
+ * \param[out] crt the CRT form of the key if the file has it, NULL otherwise.
+ * \return     the number of fields read, 2 or 7.
+ */
+int read_rsa_key(const char *path,
+                 BIGNUM** n,
+                 BIGNUM** d,
+                 struct rsa_crt** crt)
+{
+  static char f[7][129];
+  BIGNUM *p = NULL, *q = NULL, *dp = NULL, *dq = NULL, *qinv = NULL;
+  FILE *fp;
+  int got;
+
+  if (!(fp = fopen(path, "r"))) sabort();
+  got = fscanf(fp, "%128[^,],%128[^,],%128[^,],%128[^,],%128[^,],%128[^,],%128[^,\n]",
+               f[0], f[1], f[2], f[3], f[4], f[5], f[6]);
+  fclose(fp);
+  if (got != 2 && got != 7) sabort();
+  if (!BN_hex2bn(n, f[0]) || !BN_hex2bn(d, f[1])) sabort();
+  *crt = NULL;
+  if (got == 2) return got;
+
+  if (!BN_hex2bn(&p, f[2]) || !BN_hex2bn(&q, f[3]) ||
+      !BN_hex2bn(&dp, f[4]) || !BN_hex2bn(&dq, f[5]) ||
+      !BN_hex2bn(&qinv, f[6])) sabort();
+  if (!(*crt = rsa_crt_load(p, q, dp, dq, qinv))) sabort();
+  return got;
+}
+
 void ciphersuite_encode(char suite_id,
                         int *symm_cipher,
                         int *hash,
@@ -184,12 +217,9 @@ static void scipher(char *dest,
                     size_t len,
                     char *key) {
   char skey[64];
-  int i, j;
+  int i;
   int8 c;
-  char *buf;
-
-  buf = calloc(sizeof(char), len * 8);
-  if (!buf) sabort();
+  struct stream_ctx ctx;
 
   /*
    *  uniformity: using the same actual keylength of the stream cipher. This way
@@ -201,18 +231,8 @@ static void scipher(char *dest,
   }
   bzero(skey + 8*3, 64-8*3);
 
-  if (cipher_id == 2)
-    all5(buf, skey, len*8);
-  else
-    maj5(buf, skey, len*8);
-
-  for (i=0; i<len; i++) {
-    for (c=0, j=i*8; j!= (i+1)*8; j++)
-      c = c<<1 | buf[j];
-    dest[i] = s[i] ^ c;
-  }
-  free(buf);
-
+  stream_init(&ctx, cipher_id == 2 ? STREAM_ALL5 : STREAM_MAJ5, skey);
+  stream_xor(&ctx, dest, s, len);
 }
 
 static const char *iv = "abcd";
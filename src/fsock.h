@@ -58,6 +58,13 @@ void read_bn_pair(const char *path,
                   BIGNUM** a,
                   BIGNUM** b);
 
+struct rsa_crt;
+
+int read_rsa_key(const char *path,
+                 BIGNUM** n,
+                 BIGNUM** d,
+                 struct rsa_crt** crt);
+
 void ciphersuite_encode(char suite_id,
                         int *symm_cipher,
                         int *hash,
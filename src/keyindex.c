@@ -0,0 +1,322 @@
+/**
+ * \file keyindex.c
+ *
+ * Keystream-prefix index for the stream ciphers used by the client and the
+ * server.
+ *
+ * Session keys are three bytes long, expanded by scipher() to a 64-bit key
+ * with only 24 non-zero bits: each cipher has just 2²⁴ keystreams. The
+ * builder computes the first 64 bits of each, with the bitsliced engines, and
+ * writes them sorted along with their keys; the lookup maps the index and
+ * recovers the key from a known-plaintext prefix with a binary search.
+ */
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "lfsr.h"
+
+#define MAGIC "KSINDEX1"
+#define BUCKET_BITS 20
+
+
+/*
+ * Index file layout: the header, count prefixes sorted in ascending order,
+ * and then the count keys they belong to.
+ */
+struct header {
+  char magic[8];
+  char cipher[8];
+  uint64_t bits;
+  uint64_t count;
+};
+
+struct build {
+  uint64_t* (*generator)(uint64_t*, const char*, size_t);
+  uint64_t* prefixes;
+  uint64_t count;
+  uint64_t next;
+};
+
+
+void usage(void)
+{
+  fprintf(stderr,
+          "Usage: ./keyindex build [-b bits] [-j threads] <maj5|all5|a5_1> <index>\n"
+          "       ./keyindex lookup <index> <plaintext hex> <ciphertext hex>\n");
+  exit(EXIT_FAILURE);
+}
+
+static double elapsed(const struct timespec* start)
+{
+  struct timespec end;
+
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+
+/*
+ * +----------+
+ * | Building |
+ * +----------+
+ */
+
+/**
+ * \brief Computes the keystream prefixes for batches of 64 keys.
+ *
+ * Key k is expanded as in scipher(): bit i of the 64-bit key is bit i of k.
+ * The prefix is the first eight bytes of keystream, big endian.
+ */
+static void* worker(void* arg)
+{
+  struct build* b = arg;
+  char keys[64*64];
+  uint64_t out[64];
+  uint64_t base, prefix;
+  size_t i, l, t;
+
+  while ((base = __atomic_fetch_add(&b->next, 64, __ATOMIC_RELAXED)) < b->count) {
+    memset(keys, 0, sizeof(keys));
+    for (l=0; l!=64; l++)
+      for (i=0; i!=24; i++)
+        keys[64*l + i] = (base + l) >> i & 1;
+    b->generator(out, keys, 64);
+
+    for (l=0; l!=64 && base + l != b->count; l++) {
+      for (prefix=t=0; t!=64; t++)
+        prefix |= (out[t] >> l & 1) << (63 - t);
+      b->prefixes[base + l] = prefix;
+    }
+  }
+
+  return NULL;
+}
+
+/**
+ * \brief Sorts the prefixes, along with their keys.
+ *
+ * Prefixes are uniformly distributed: a counting pass on their top bits
+ * scatters them into buckets of a few dozen entries at most, then sorted by
+ * insertion.
+ */
+static void sort(uint64_t* sorted,
+                 uint32_t* keys,
+                 const uint64_t* prefixes,
+                 uint64_t count)
+{
+  uint64_t* start;
+  uint64_t i, j, b, p;
+  uint32_t k;
+  const int shift = 64 - BUCKET_BITS;
+
+  start = calloc((1 << BUCKET_BITS) + 1, sizeof(uint64_t));
+  for (i=0; i!=count; i++)
+    start[(prefixes[i] >> shift) + 1]++;
+  for (b=0; b!=1 << BUCKET_BITS; b++)
+    start[b+1] += start[b];
+
+  for (i=0; i!=count; i++) {
+    b = prefixes[i] >> shift;
+    sorted[start[b]] = prefixes[i];
+    keys[start[b]++] = i;
+  }
+
+  /* start[b] is now where bucket b ends */
+  for (b=0; b!=1 << BUCKET_BITS; b++)
+    for (i = b ? start[b-1] : 0; i != start[b]; i++) {
+      p = sorted[i];
+      k = keys[i];
+      for (j=i; j != (b ? start[b-1] : 0) && sorted[j-1] > p; j--) {
+        sorted[j] = sorted[j-1];
+        keys[j] = keys[j-1];
+      }
+      sorted[j] = p;
+      keys[j] = k;
+    }
+
+  free(start);
+}
+
+static int build(int argc, char** argv)
+{
+  struct build b;
+  struct header h;
+  struct timespec start;
+  pthread_t* tids;
+  uint64_t* sorted;
+  uint32_t* keys;
+  FILE* fp;
+  int opt, threads, bits, t;
+  double generation, sorting, writing;
+
+  threads = sysconf(_SC_NPROCESSORS_ONLN);
+  bits = 24;
+  while ((opt = getopt(argc, argv, "b:j:")) != -1)
+    switch (opt) {
+    case 'b': bits = atoi(optarg); break;
+    case 'j': threads = atoi(optarg); break;
+    default: usage();
+    }
+  if (argc - optind != 2 || bits < 1 || bits > 24) usage();
+  if (threads < 1) threads = 1;
+
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, MAGIC, sizeof(h.magic));
+  strncpy(h.cipher, argv[optind], sizeof(h.cipher) - 1);
+  if (!strcmp(h.cipher, "maj5")) b.generator = maj5_x64;
+  else if (!strcmp(h.cipher, "all5")) b.generator = all5_x64;
+  else if (!strcmp(h.cipher, "a5_1")) b.generator = a5_1_x64;
+  else usage();
+  h.bits = bits;
+  h.count = b.count = (uint64_t) 1 << bits;
+  b.next = 0;
+
+  b.prefixes = malloc(b.count * sizeof(uint64_t));
+  sorted = malloc(b.count * sizeof(uint64_t));
+  keys = malloc(b.count * sizeof(uint32_t));
+  tids = malloc(threads * sizeof(pthread_t));
+  if (!b.prefixes || !sorted || !keys || !tids) {
+    perror("malloc");
+    return EXIT_FAILURE;
+  }
+
+  printf("[+] Computing %lu keystream prefixes with %d threads...\n",
+         (unsigned long) b.count, threads);
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (t=0; t!=threads; t++)
+    if (pthread_create(&tids[t], NULL, worker, &b)) abort();
+  for (t=0; t!=threads; t++)
+    pthread_join(tids[t], NULL);
+  generation = elapsed(&start);
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  sort(sorted, keys, b.prefixes, b.count);
+  sorting = elapsed(&start);
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  fp = fopen(argv[optind+1], "w");
+  if (!fp ||
+      fwrite(&h, sizeof(h), 1, fp) != 1 ||
+      fwrite(sorted, sizeof(uint64_t), b.count, fp) != b.count ||
+      fwrite(keys, sizeof(uint32_t), b.count, fp) != b.count ||
+      fclose(fp)) {
+    perror(argv[optind+1]);
+    return EXIT_FAILURE;
+  }
+  writing = elapsed(&start);
+
+  printf("[+] generation %.3f s, sorting %.3f s, writing %.3f s\n",
+         generation, sorting, writing);
+  printf("[+] %s: %lu bytes\n", argv[optind+1],
+         (unsigned long) (sizeof(h) + b.count * (sizeof(uint64_t) + sizeof(uint32_t))));
+
+  free(tids);
+  free(keys);
+  free(sorted);
+  free(b.prefixes);
+  return EXIT_SUCCESS;
+}
+
+
+/*
+ * +--------+
+ * | Lookup |
+ * +--------+
+ */
+
+static size_t parse_hex(unsigned char* dest, const char* s, size_t max)
+{
+  size_t n;
+  unsigned int byte;
+
+  for (n=0; n!=max && sscanf(s + 2*n, "%2x", &byte) == 1; n++)
+    dest[n] = byte;
+  return n;
+}
+
+/** First position in prefixes[0, count) not less than p. */
+static uint64_t lower_bound(const uint64_t* prefixes, uint64_t count, uint64_t p)
+{
+  uint64_t lo, hi, mid;
+
+  for (lo=0, hi=count; lo != hi; ) {
+    mid = lo + (hi - lo) / 2;
+    if (prefixes[mid] < p) lo = mid + 1;
+    else hi = mid;
+  }
+  return lo;
+}
+
+static int lookup(int argc, char** argv)
+{
+  struct header* h;
+  struct stat st;
+  struct timespec start;
+  const uint64_t* prefixes;
+  const uint32_t* keys;
+  unsigned char plain[8], cipher[8];
+  uint64_t p, mask, i, first;
+  size_t n, found;
+  double us;
+  int fd;
+
+  if (argc != 5) usage();
+  fd = open(argv[2], O_RDONLY);
+  if (fd < 0 || fstat(fd, &st)) {
+    perror(argv[2]);
+    return EXIT_FAILURE;
+  }
+  h = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  if (h == MAP_FAILED) {
+    perror("mmap");
+    return EXIT_FAILURE;
+  }
+  if (memcmp(h->magic, MAGIC, sizeof(h->magic)) ||
+      (uint64_t) st.st_size != sizeof(*h) + h->count * 12) {
+    fprintf(stderr, "%s: not a keystream index\n", argv[2]);
+    return EXIT_FAILURE;
+  }
+  prefixes = (const uint64_t*) (h + 1);
+  keys = (const uint32_t*) (prefixes + h->count);
+
+  /* up to eight bytes of known plaintext */
+  n = parse_hex(plain, argv[3], 8);
+  if (parse_hex(cipher, argv[4], 8) < n) n = parse_hex(cipher, argv[4], 8);
+  if (!n) usage();
+  for (p=i=0; i!=n; i++)
+    p |= (uint64_t) (plain[i] ^ cipher[i]) << (56 - 8*i);
+  mask = n == 8 ? ~(uint64_t) 0 : ~(~(uint64_t) 0 >> (8*n));
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  first = lower_bound(prefixes, h->count, p);
+  for (i=first; i != h->count && (prefixes[i] & mask) == p; i++) ;
+  us = elapsed(&start) * 1e6;
+
+  for (found=0; first != i; first++, found++)
+    printf("[+] %s key: %02x%02x%02x\n", h->cipher,
+           keys[first] & 0xff, keys[first] >> 8 & 0xff, keys[first] >> 16);
+  if (!found) printf("[-] no key found\n");
+  fprintf(stderr, "[+] %zu candidates in %.1f us\n", found, us);
+
+  munmap(h, st.st_size);
+  close(fd);
+  return found ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+
+int main(int argc, char** argv)
+{
+  if (argc < 2) usage();
+  if (!strcmp(argv[1], "build")) return build(argc - 1, argv + 1);
+  if (!strcmp(argv[1], "lookup")) return lookup(argc, argv);
+  usage();
+  return EXIT_FAILURE;
+}
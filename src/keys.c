@@ -2,8 +2,22 @@
  * \file keys.c
  *
  * Generate RSA keys for the client and server.
+ *
+ * With -j, each of the two safe primes is searched for by that many threads.
+ *
+ * With -n, keys are provisioned in bulk instead: count named clients get a key
+ * pair each, generated by -j workers (all cores by default). Their public keys
+ * go to the registry the server reads, clients_rsa<bits>_public_keys.txt, and
+ * each private key, with its CRT form, to <name>_rsa<bits>_private_key.txt,
+ * both under -o.
  */
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
 
 #include <openssl/bn.h>
 
@@ -13,40 +27,246 @@
 
 void usage(void)
 {
-  fprintf(stderr, "Usage: ./key <bits>\n");
+  fprintf(stderr,
+          "Usage: ./keys [-j threads] <bits>\n"
+          "       ./keys -n count [-j threads] [-o dir] [-p prefix] <bits>\n");
   exit(EXIT_FAILURE);
 }
 
 
-int main(int argc, char **argv)
+static double elapsed(const struct timespec* start)
 {
+  struct timespec end;
+
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+
+/*
+ * +--------------------+
+ * | Batch Provisioning |
+ * +--------------------+
+ */
+
+struct batch {
   int bits;
+  unsigned long count;
+  const char* dir;
+  const char* prefix;
+  unsigned long next;
+  unsigned long done;
+  FILE* registry;
+  pthread_mutex_t lock;
+  pthread_cond_t finished;
+};
+
+/* N,D,P,Q,DP,DQ,QINV, as read_rsa_key() takes them */
+static void write_private(const struct batch* b, const char* name,
+                          const BIGNUM* n, const BIGNUM* d, const struct rsa_crt* crt)
+{
+  const BIGNUM* fields[7];
+  char path[PATH_MAX];
+  char* hex;
+  FILE* fp;
+  int i, err = 0;
+
+  if (!crt) {
+    fprintf(stderr, "[-] %s: no CRT form for this key\n", name);
+    exit(EXIT_FAILURE);
+  }
+  fields[0] = n;
+  fields[1] = d;
+  fields[2] = crt->p;
+  fields[3] = crt->q;
+  fields[4] = crt->dp;
+  fields[5] = crt->dq;
+  fields[6] = crt->qinv;
+  snprintf(path, sizeof(path), "%s/%s_rsa%d_private_key.txt", b->dir, name, b->bits);
+  if (!(fp = fopen(path, "w"))) err = 1;
+  for (i=0; i!=7 && !err; i++) {
+    hex = BN_bn2hex(fields[i]);
+    err = fprintf(fp, "%s%c", hex, i == 6 ? '\n' : ',') < 0;
+    OPENSSL_free(hex);
+  }
+  if (err || fclose(fp)) {
+    perror(path);
+    exit(EXIT_FAILURE);
+  }
+}
+
+static void* worker(void* arg)
+{
+  struct batch* b = arg;
+  BIGNUM
+    *n = BN_new(),
+    *e = BN_new(),
+    *d = BN_new(),
+    *phi = BN_new();
+  struct rsa_crt* crt;
+  char name[64];
+  char *sn, *se;
+  unsigned long i;
+
+  while ((i = __atomic_fetch_add(&b->next, 1, __ATOMIC_RELAXED)) < b->count) {
+    rsa_genkey_parallel(1, b->bits, n, phi, e, d, &crt);
+    snprintf(name, sizeof(name), "%s%lu", b->prefix, i);
+    write_private(b, name, n, d, crt);
+    rsa_crt_free(crt);
+
+    sn = BN_bn2hex(n);
+    se = BN_bn2hex(e);
+    pthread_mutex_lock(&b->lock);
+    fprintf(b->registry, "%s %s %s\n", name, sn, se);
+    if (++b->done == b->count) pthread_cond_signal(&b->finished);
+    pthread_mutex_unlock(&b->lock);
+    OPENSSL_free(sn);
+    OPENSSL_free(se);
+  }
+
+  BN_free(n);
+  BN_free(e);
+  BN_free(d);
+  BN_free(phi);
+  return NULL;
+}
+
+static int batch(struct batch* b, int threads)
+{
+  char path[PATH_MAX];
+  struct timespec start, wake;
+  pthread_condattr_t attr;
+  pthread_t* tids;
+  double secs;
+  int t;
+
+  snprintf(path, sizeof(path), "%s/clients_rsa%d_public_keys.txt", b->dir, b->bits);
+  if (!(b->registry = fopen(path, "w"))) {
+    perror(path);
+    return EXIT_FAILURE;
+  }
+  pthread_mutex_init(&b->lock, NULL);
+  /* timed waits count from start, on the same clock */
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&b->finished, &attr);
+  pthread_condattr_destroy(&attr);
+  b->next = b->done = 0;
+  tids = malloc(threads * sizeof(pthread_t));
+
+  printf("[+] Provisioning %lu RSA%d keys, %d thread%s, into %s/...\n",
+         b->count, b->bits, threads, threads == 1 ? "" : "s", b->dir);
+  fflush(stdout);
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (t=0; t!=threads; t++)
+    if (pthread_create(&tids[t], NULL, worker, b)) abort();
+
+  /* report progress once a second, until every key is out */
+  pthread_mutex_lock(&b->lock);
+  wake = start;
+  while (b->done != b->count) {
+    wake.tv_sec++;
+    if (pthread_cond_timedwait(&b->finished, &b->lock, &wake) == ETIMEDOUT)
+      fprintf(stderr, "\r[+] %lu/%lu keys, %.1f keys/s",
+              b->done, b->count, b->done / elapsed(&start));
+  }
+  pthread_mutex_unlock(&b->lock);
+  secs = elapsed(&start);
+  for (t=0; t!=threads; t++)
+    pthread_join(tids[t], NULL);
+  if (fclose(b->registry)) {
+    perror(path);
+    return EXIT_FAILURE;
+  }
+  if (secs >= 1) fprintf(stderr, "\n");
+
+  printf("[+] %lu keys in %.3f s, %.1f keys/s\n", b->count, secs, b->count / secs);
+  printf("[+] Registry: %s\n", path);
+  pthread_cond_destroy(&b->finished);
+  pthread_mutex_destroy(&b->lock);
+  free(tids);
+  return EXIT_SUCCESS;
+}
+
+
+int main(int argc, char **argv)
+{
+  struct batch b = {.dir = ".", .prefix = "client"};
+  int bits, threads = 0, opt;
+  struct timespec start;
   BIGNUM
     *n = BN_new(),
     *e = BN_new(),
     *d = BN_new(),
     *phi = BN_new(),
-    *one = BN_new();
+    *one = BN_new(),
+    *m = BN_new();
+  struct rsa_crt *crt;
   BN_CTX *ctx = BN_CTX_new();
 
-  if (argc < 2)  usage();
+  while ((opt = getopt(argc, argv, "j:n:o:p:")) != -1)
+    switch (opt) {
+    case 'j':
+      if ((threads = atoi(optarg)) < 1) usage();
+      break;
+    case 'n':
+      if (!(b.count = strtoul(optarg, NULL, 0))) usage();
+      break;
+    case 'o':
+      b.dir = optarg;
+      break;
+    case 'p':
+      b.prefix = optarg;
+      break;
+    default:
+      usage();
+    }
+  if (optind >= argc) usage();
 
-  bits = atoi(argv[1]);
+  bits = atoi(argv[optind]);
   if (bits < 16) usage();
 
-  printf("[+] Generating RSA%d key...\n", bits);
-  rsa_genkey(bits, n, phi, e, d);
-  printf("[+] New RSA%d key found:\n", bits);
+  if (b.count) {
+    b.bits = bits;
+    return batch(&b, threads ? threads : sysconf(_SC_NPROCESSORS_ONLN));
+  }
+  if (!threads) threads = 1;
+
+  printf("[+] Generating RSA%d key, %d thread%s...\n", bits, threads,
+         threads == 1 ? "" : "s");
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  rsa_genkey_parallel(threads, bits, n, phi, e, d, &crt);
+  if (!crt) {
+    fprintf(stderr, "[-] No CRT form for the new key\n");
+    return EXIT_FAILURE;
+  }
+  printf("[+] New RSA%d key found in %.3f s:\n", bits, elapsed(&start));
   printf("   N: ");  BN_print_fp(stdout, n); printf("\n");
   printf("   e: ");  BN_print_fp(stdout, e); printf("\n");
   printf("   d: ");  BN_print_fp(stdout, d); printf("\n");
   printf(" phi: ");  BN_print_fp(stdout, phi); printf("\n");
+  printf("   p: ");  BN_print_fp(stdout, crt->p); printf("\n");
+  printf("   q: ");  BN_print_fp(stdout, crt->q); printf("\n");
+  printf("  dp: ");  BN_print_fp(stdout, crt->dp); printf("\n");
+  printf("  dq: ");  BN_print_fp(stdout, crt->dq); printf("\n");
+  printf("qinv: ");  BN_print_fp(stdout, crt->qinv); printf("\n");
 
 
   printf("\n[+] Verifying correctedness...");
   BN_mod_mul(one, e, d, phi, ctx);
   printf(BN_is_one(one)?"[ok]\n":"[fail]\n");
+
+  /* a round trip through the CRT form */
+  printf("[+] Verifying the CRT form...");
+  BN_set_word(one, 0xc0ffee);
+  BN_mod(m, one, n, ctx);
+  BN_copy(one, m);
+  rsa_encrypt(one, e, n);
+  rsa_crt_decrypt(one, crt);
+  printf(!BN_cmp(one, m)?"[ok]\n":"[fail]\n");
   BN_CTX_free(ctx);
+  BN_free(m);
+  rsa_crt_free(crt);
   BN_free(one);
   BN_free(n);
   BN_free(e);
@@ -0,0 +1,194 @@
+/**
+ * \file bm.c
+ * \brief Linear complexity of binary sequences.
+ *
+ * Berlekamp–Massey over 𝔽₂ on bit-packed sequences: both the discrepancy and
+ * the update of the connection polynomial are computed 64 coefficients at a
+ * time, making sequences of 10⁷ bits affordable.
+ *
+ * Sequences are packed with bit i of word i/64 holding the i-th element.
+ */
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bm.h"
+#include "vectorize.h"
+
+static inline uint64_t rev64(uint64_t x)
+{
+  x = (x >> 1 & 0x5555555555555555) | (x & 0x5555555555555555) << 1;
+  x = (x >> 2 & 0x3333333333333333) | (x & 0x3333333333333333) << 2;
+  x = (x >> 4 & 0x0f0f0f0f0f0f0f0f) | (x & 0x0f0f0f0f0f0f0f0f) << 4;
+  return __builtin_bswap64(x);
+}
+
+/**
+ * \brief Discrepancy: parity of the first `words` words of c AND v >> o.
+ */
+VECTORIZE
+static int discrepancy(const uint64_t* c, const uint64_t* v, size_t o, size_t words)
+{
+  uint64_t acc;
+  size_t k;
+  unsigned b = o % 64;
+
+  v += o / 64;
+  acc = 0;
+  if (!b)
+    for (k=0; k!=words; k++)
+      acc ^= c[k] & v[k];
+  else
+    for (k=0; k!=words; k++)
+      acc ^= c[k] & (v[k] >> b | v[k+1] << (64-b));
+
+  return __builtin_parityll(acc);
+}
+
+/**
+ * \brief dest = c + x^shift · v, on words [shift/64, top].
+ *
+ * dest may equal either c or v: words are processed from the top down, and
+ * word k only depends on words k, k-1 of v.
+ */
+VECTORIZE
+static void shift_xor(uint64_t* dest, const uint64_t* c, const uint64_t* v,
+                      size_t shift, size_t top)
+{
+  size_t k, q = shift / 64;
+  unsigned b = shift % 64;
+
+  if (!b)
+    for (k=top+1; k-- > q; )
+      dest[k] = c[k] ^ v[k-q];
+  else {
+    for (k=top+1; k-- > q+1; )
+      dest[k] = c[k] ^ (v[k-q] << b | v[k-q-1] >> (64-b));
+    dest[q] = c[q] ^ v[0] << b;
+  }
+}
+
+
+/**
+ * \brief Packs a sequence of bits, one per byte, into 64-bit words.
+ *
+ * \param dest destination, of at least n/64 + 1 words.
+ * \param bits the sequence, as returned by \ref maj5() and friends.
+ * \param n length of the sequence.
+ *
+ * \return dest
+ */
+uint64_t* pack_bits(uint64_t* dest, const char* bits, size_t n)
+{
+  size_t i;
+
+  memset(dest, 0, (n/64 + 1) * sizeof(uint64_t));
+  for (i=0; i!=n; i++)
+    dest[i/64] |= (uint64_t) (bits[i] & 1) << (i%64);
+
+  return dest;
+}
+
+/**
+ * \brief Berlekamp–Massey, in O(n²/64).
+ *
+ * The sequence is bit-reversed first, so that the window s_N, s_(N-1), …,
+ * s_(N-L) paired with the connection polynomial C(x) = 1 + c₁x + … + c_Lx^L
+ * is a contiguous run of bits, and the discrepancy is the parity of a
+ * word-wise AND.
+ * When the length changes, the new C(x) is written over the old B(x) and the
+ * two are swapped, so that no copy is needed.
+ *
+ * \param[out] profile if not NULL, profile[N] is set to the linear complexity
+ *                     of the first N+1 bits.
+ * \param[out] poly if not NULL, the connection polynomial, bit i of word i/64
+ *                  holding cᵢ: at least n/64 + 1 words.
+ *
+ * \return the linear complexity of the whole sequence.
+ */
+static size_t bm(const uint64_t* s, size_t n, size_t* profile, uint64_t* poly)
+{
+  uint64_t *r, *c, *b, *tmp;
+  size_t words, top, pad, N, L, newL, k, shift;
+
+  if (!n) {
+    if (poly) poly[0] = 1;
+    return 0;
+  }
+  words = (n+63) / 64;
+  pad = 64 * words;
+  r = calloc(words + 2, sizeof(uint64_t));
+  c = calloc(words + 2, sizeof(uint64_t));
+  b = calloc(words + 2, sizeof(uint64_t));
+  assert(r && c && b);
+
+  /* bit j of r is s_(pad-1-j) */
+  for (k=0; k!=words; k++)
+    r[k] = rev64(s[words-1-k]);
+  /* drop the bits past the end of the sequence */
+  if (pad != n)
+    r[0] &= ~(((uint64_t) 1 << (pad-n)) - 1);
+
+  c[0] = b[0] = 1;
+  L = 0;
+  shift = 1;
+  for (N=0; N!=n; N++) {
+    /* discrepancy: s_N + Σ cᵢ s_(N-i) */
+    if (discrepancy(c, r, pad-1-N, L/64 + 1)) {
+      if (2*L <= N) {
+        /* B(x) ← C(x) + x^shift B(x), then swap */
+        newL = N + 1 - L;
+        top = newL / 64;
+        for (k=shift/64; k-- > 0; )
+          b[k] = c[k];
+        shift_xor(b, c, b, shift, top);
+        tmp = c; c = b; b = tmp;
+        L = newL;
+        shift = 0;
+      } else {
+        /* C(x) ← C(x) + x^shift B(x) */
+        shift_xor(c, c, b, shift, L/64);
+      }
+    }
+    shift++;
+    if (profile) profile[N] = L;
+  }
+  if (poly) memcpy(poly, c, (L/64 + 1) * sizeof(uint64_t));
+
+  free(r);
+  free(c);
+  free(b);
+  return L;
+}
+
+/**
+ * \brief Linear complexity and linear complexity profile of a sequence.
+ *
+ * \param s the packed sequence, of (n+63)/64 words.
+ * \param n length of the sequence, in bits.
+ * \param[out] profile if not NULL, profile[N] is set to the linear complexity
+ *                     of the first N+1 bits.
+ *
+ * \return the linear complexity of the whole sequence.
+ */
+size_t linear_complexity(const uint64_t* s, size_t n, size_t* profile)
+{
+  return bm(s, n, profile, NULL);
+}
+
+/**
+ * \brief Shortest LFSR generating a sequence.
+ *
+ * \param s the packed sequence, of (n+63)/64 words.
+ * \param n length of the sequence, in bits.
+ * \param[out] poly the connection polynomial C(x) = 1 + c₁x + … + c_Lx^L, with
+ *                  sₜ = Σ cᵢsₜ₋ᵢ for L ≤ t < n: bit i of word i/64 holds cᵢ.
+ *                  At least n/64 + 1 words, those past L/64 left untouched.
+ *
+ * \return L, the linear complexity of the sequence.
+ */
+size_t connection_polynomial(const uint64_t* s, size_t n, uint64_t* poly)
+{
+  return bm(s, n, NULL, poly);
+}
@@ -7,12 +7,15 @@
  *
  */
 #include <assert.h>
+#include <pthread.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "field.h"
 #include "bunny24.h"
+#include "vectorize.h"
 
 
 const int8 e = 0x2;
@@ -376,6 +379,115 @@ char* reduced_bunny24_decrypt(char* dest, const char* ckey, const char* cipherte
   return block_to_bytes(dest, cipher);
 }
 
+/*
+ * +-------------------------+
+ * | Table-Driven Encryption |
+ * +-------------------------+
+ */
+
+/*
+ * A block, read big-endian, is the 24-bit word v₀‖v₁‖v₂‖v₃ of its four 6-bit
+ * coordinates. A round is then four table lookups and a xor: table j maps vⱼ
+ * to row j of the mixing matrix scaled by its image through S-box j. The
+ * tables are filled once; expanded keys make encrypting a block allocation
+ * free, for keystreams and other bulk users.
+ */
+static uint32_t round_table[4][64];
+
+static pthread_once_t round_table_once = PTHREAD_ONCE_INIT;
+
+static uint32_t block_to_word(const int8* v)
+{
+  return (uint32_t) v[0] << 18 | (uint32_t) v[1] << 12 | v[2] << 6 | v[3];
+}
+
+static void round_table_init(void)
+{
+  int8 v[4], w[4], mixed[4];
+  size_t i, j;
+
+  for (j=0; j!=4; j++)
+    for (i=0; i!=64; i++) {
+      memset(v, 0, sizeof(v));
+      v[j] = i;
+      sbox(w, v);
+      /* keep coordinate j alone: S₄'s constant goes in its own table only */
+      memset(v, 0, sizeof(v));
+      v[j] = w[j];
+      round_table[j][i] = block_to_word(mixing_layer(mixed, v));
+    }
+}
+
+/**
+ * \brief Expands a 24-bit key for \ref bunny24_encrypt_block().
+ *
+ * \param[out] k   the expanded key.
+ * \param[in]  key three bytes of key, as for \ref bunny24_encrypt().
+ * \return     k
+ */
+struct bunny24_key* bunny24_setkey(struct bunny24_key* k, const char* key)
+{
+  int8 round_keys[16][4];
+  int8* rk[16];
+  size_t i;
+
+  pthread_once(&round_table_once, round_table_init);
+  for (i=0; i!=16; i++)
+    rk[i] = round_keys[i];
+  key_schedule(rk, key);
+  for (i=0; i!=16; i++)
+    k->rk[i] = block_to_word(round_keys[i]);
+  memset(round_keys, 0, sizeof(round_keys));
+
+  return k;
+}
+
+/**
+ * \brief Encrypts one block, given as the big-endian word of its 3 bytes.
+ *
+ * Same as \ref bunny24_encrypt() under the key k was expanded from.
+ */
+uint32_t bunny24_encrypt_block(const struct bunny24_key* k, uint32_t x)
+{
+  size_t i;
+
+  x ^= k->rk[0];
+  for (i=1; i!=16; i++)
+    x = round_table[0][x >> 18] ^ round_table[1][x >> 12 & 0x3f] ^
+        round_table[2][x >> 6 & 0x3f] ^ round_table[3][x & 0x3f] ^ k->rk[i];
+
+  return x;
+}
+
+/**
+ * \brief Counter mode: encrypts the n blocks ctr, ctr+1, … (mod 2^24).
+ *
+ * Rounds go over the whole batch in turn, so that the blocks are looked up
+ * side by side (gathers, with AVX2).
+ *
+ * \param[out] dest n encrypted blocks, as words.
+ * \return     dest
+ */
+VECTORIZE
+uint32_t* bunny24_ctr_blocks(const struct bunny24_key* k, uint32_t* restrict dest,
+                             uint32_t ctr, size_t n)
+{
+  size_t i, r;
+  uint32_t x;
+
+  for (i=0; i!=n; i++)
+    dest[i] = ((ctr + i) & 0xffffff) ^ k->rk[0];
+  for (r=1; r!=16; r++)
+    for (i=0; i!=n; i++) {
+      x = dest[i];
+      dest[i] = round_table[0][x >> 18] ^ round_table[1][x >> 12 & 0x3f] ^
+        round_table[2][x >> 6 & 0x3f] ^ round_table[3][x & 0x3f] ^ k->rk[r];
+    }
+
+  return dest;
+}
+
+
 /*
  * +-----------------------+
  * | Cipher Block Chaining |
@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <assert.h>
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -84,6 +85,360 @@ int8 f2rot(int8 p, int8 n, int r)
 }
 
 
+/*
+ * +-------------------------------+
+ * | Polynomials of Large Degree   |
+ * +-------------------------------+
+ */
+
+/**
+ * \brief Degree of a polynomial.
+ *
+ * \return the degree of `a`, or -1 if `a` is the zero polynomial.
+ */
+int f2deg(f2poly a)
+{
+  uint64_t high = a >> 64;
+
+  if (high) return 127 - __builtin_clzll(high);
+  if ((uint64_t) a) return 63 - __builtin_clzll((uint64_t) a);
+  return -1;
+}
+
+/**
+ * \brief Remainder of the division of `a` by `m`.
+ *
+ * \param a any polynomial
+ * \param m a non-zero polynomial
+ */
+f2poly f2mod(f2poly a, f2poly m)
+{
+  int i, n;
+
+  n = f2deg(m);
+  assert(n >= 0);
+  for (i=f2deg(a); i >= n; i--)
+    if (a >> i & 1) a ^= m << (i-n);
+
+  return a;
+}
+
+/**
+ * \brief Product of two polynomials modulo `m`.
+ *
+ * Same as \ref f2mul(), for moduli of degree up to 64.
+ *
+ * \param m the modulus, of degree n ≤ 64
+ * \param a a polynomial of degree less than n
+ * \param b a polynomial of degree less than n
+ */
+f2poly f2mulmod(f2poly m, f2poly a, f2poly b)
+{
+  f2poly r;
+  int n = f2deg(m);
+
+  assert(n <= 64);
+  for (r = 0; b; b >>= 1) {
+    if (b & 1) r ^= a;
+    a <<= 1;
+    if (a >> n & 1) a ^= m;
+  }
+
+  return r;
+}
+
+/**
+ * \brief Modular exponentiation.
+ *
+ * Computes aᵉ mod m by square and multiply, in O(n² log e) for m of degree n.
+ *
+ * \param m the modulus, of degree up to 64
+ * \param a any polynomial
+ * \param e the exponent
+ */
+f2poly f2expmod(f2poly m, f2poly a, uint64_t e)
+{
+  f2poly r;
+
+  a = f2mod(a, m);
+  for (r = f2mod(1, m); e; e >>= 1) {
+    if (e & 1) r = f2mulmod(m, r, a);
+    a = f2mulmod(m, a, a);
+  }
+
+  return r;
+}
+
+/**
+ * \brief Greatest common divisor of two polynomials.
+ */
+f2poly f2gcd(f2poly a, f2poly b)
+{
+  f2poly r;
+
+  while (b) {
+    r = f2mod(a, b);
+    a = b;
+    b = r;
+  }
+  return a;
+}
+
+/**
+ * \brief Quotient of the division of `a` by `m`.
+ */
+static f2poly f2quo(f2poly a, f2poly m)
+{
+  f2poly q;
+  int i, n;
+
+  n = f2deg(m);
+  for (q=0, i=f2deg(a); i >= n; i--)
+    if (a >> i & 1) {
+      a ^= m << (i-n);
+      q |= (f2poly) 1 << (i-n);
+    }
+
+  return q;
+}
+
+
+/*
+ * +-----------------------+
+ * | Multiplicative Order  |
+ * +-----------------------+
+ */
+
+/* the prime factors of 2ⁿ - 1, with repetitions, zero-terminated */
+#define MAX_FACTORS 16
+static uint64_t mersenne[65][MAX_FACTORS];
+static pthread_once_t mersenne_once = PTHREAD_ONCE_INIT;
+
+static inline uint64_t mulmod(uint64_t a, uint64_t b, uint64_t n)
+{
+  return (unsigned __int128) a * b % n;
+}
+
+static uint64_t powmod(uint64_t a, uint64_t e, uint64_t n)
+{
+  uint64_t r;
+
+  for (r=1; e; e >>= 1) {
+    if (e & 1) r = mulmod(r, a, n);
+    a = mulmod(a, a, n);
+  }
+  return r;
+}
+
+/**
+ * \brief Deterministic Miller-Rabin test, valid for all n < 2⁶⁴.
+ */
+static int is_prime(uint64_t n)
+{
+  static const uint64_t bases[] = {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37};
+  uint64_t d, x;
+  size_t i;
+  int r, s;
+
+  if (n < 2) return 0;
+  for (i=0; i!=sizeof(bases)/sizeof(uint64_t); i++) {
+    if (n == bases[i]) return 1;
+    if (n % bases[i] == 0) return 0;
+  }
+
+  for (d=n-1, s=0; !(d & 1); d >>= 1) s++;
+  for (i=0; i!=sizeof(bases)/sizeof(uint64_t); i++) {
+    x = powmod(bases[i], d, n);
+    if (x == 1 || x == n-1) continue;
+    for (r=1; r < s && x != n-1; r++)
+      x = mulmod(x, x, n);
+    if (x != n-1) return 0;
+  }
+  return 1;
+}
+
+static uint64_t gcd(uint64_t a, uint64_t b)
+{
+  uint64_t r;
+
+  while (b) {
+    r = a % b;
+    a = b;
+    b = r;
+  }
+  return a;
+}
+
+/**
+ * \brief Pollard's rho, Brent's variant: a non-trivial factor of the odd
+ * composite n.
+ */
+static uint64_t rho(uint64_t n)
+{
+  uint64_t c, x, y, ys, q, d;
+  size_t i, k, r;
+  const size_t m = 128;
+
+  for (c=1; ; c++) {
+    y = 2;
+    q = 1;
+    d = 1;
+    for (r=1; d == 1; r <<= 1) {
+      x = y;
+      for (i=0; i!=r; i++)
+        y = (mulmod(y, y, n) + c) % n;
+      for (k=0; k < r && d == 1; k += m) {
+        ys = y;
+        for (i=0; i!=m && i < r-k; i++) {
+          y = (mulmod(y, y, n) + c) % n;
+          q = mulmod(q, x > y ? x-y : y-x, n);
+        }
+        d = gcd(q, n);
+      }
+    }
+    /* too many factors got collected at once: backtrack */
+    if (d == n)
+      do {
+        ys = (mulmod(ys, ys, n) + c) % n;
+        d = gcd(x > ys ? x-ys : ys-x, n);
+      } while (d == 1);
+    if (d != n) return d;
+  }
+}
+
+static size_t factor(uint64_t n, uint64_t* primes)
+{
+  uint64_t d;
+  size_t found;
+
+  if (n == 1) return 0;
+  for (found=0; !(n & 1); n >>= 1) primes[found++] = 2;
+  if (n == 1) return found;
+  if (is_prime(n)) {
+    primes[found] = n;
+    return found + 1;
+  }
+  d = rho(n);
+  found += factor(d, primes + found);
+  return found + factor(n / d, primes + found);
+}
+
+static void mersenne_init(void)
+{
+  size_t n;
+
+  for (n=1; n<=64; n++)
+    factor(n == 64 ? UINT64_MAX : ((uint64_t) 1 << n) - 1, mersenne[n]);
+}
+
+/**
+ * \brief Order of x modulo h, a product of distinct irreducible polynomials
+ * of degree n.
+ *
+ * Every factor has order dividing 2ⁿ - 1, and so does their least common
+ * multiple: strip the prime factors of 2ⁿ - 1 as long as x stays a root.
+ */
+static uint64_t order_ddf(f2poly h, int n)
+{
+  uint64_t e;
+  const uint64_t* q;
+
+  e = n == 64 ? UINT64_MAX : ((uint64_t) 1 << n) - 1;
+  for (q=mersenne[n]; *q; q++)
+    if (f2expmod(h, 2, e / *q) == 1) e /= *q;
+  return e;
+}
+
+/**
+ * \brief Irreducibility test (Rabin).
+ *
+ * m of degree n is irreducible iff x^(2ⁿ) = x mod m and
+ * gcd(x^(2^(n/q)) - x, m) = 1 for each prime q dividing n.
+ *
+ * \param m a polynomial of degree up to 64.
+ * \return 1 if `m` is irreducible, 0 otherwise.
+ */
+int f2irreducible(f2poly m)
+{
+  f2poly xp;
+  int i, n, q, left;
+
+  n = f2deg(m);
+  if (n < 1) return 0;
+  for (q=2, left=n; q <= left; q++) {
+    if (left % q) continue;
+    /* q is the smallest prime factor of what is left of n */
+    for (xp=f2mod(2, m), i=0; i != n/q; i++)
+      xp = f2mulmod(m, xp, xp);
+    if (f2deg(f2gcd(m, xp ^ 2)) > 0) return 0;
+    while (left % q == 0) left /= q;
+  }
+
+  for (xp=f2mod(2, m), i=0; i!=n; i++)
+    xp = f2mulmod(m, xp, xp);
+  return xp == f2mod(2, m);
+}
+
+/**
+ * \brief Multiplicative order of x modulo m.
+ *
+ * The smallest e > 0 such that xᵉ = 1 mod m, that is the period of a LFSR with
+ * characteristic polynomial m.
+ * The distinct irreducible factors of m are grouped by degree with a
+ * distinct-degree factorization, and the order of each group is found from
+ * the factorization of 2ⁿ - 1.
+ * Repeated factors multiply the order of the square-free part by the least
+ * power of two not smaller than their multiplicity.
+ *
+ * \param m a polynomial of degree up to 64.
+ * \return the order of x, or 0 if x divides `m` (and thus has no order).
+ */
+uint64_t f2order(f2poly m)
+{
+  f2poly rest, xp, g, h;
+  uint64_t order, e;
+  int d;
+
+  if (!(m & 1) || f2deg(m) < 1) return 0;
+  pthread_once(&mersenne_once, mersenne_init);
+
+  order = 1;
+  rest = m;
+  xp = f2mod(2, m);
+  for (d=1; f2deg(rest) >= 2*d; d++) {
+    /* product of the irreducible factors of degree d */
+    xp = f2mulmod(m, xp, xp);
+    g = f2gcd(rest, xp ^ 2);
+    if (f2deg(g) < 1) continue;
+    e = order_ddf(g, d);
+    order = order / gcd(order, e) * e;
+    for (h=g; f2deg(h) > 0; h=f2gcd(rest, g))
+      rest = f2quo(rest, h);
+  }
+  if (f2deg(rest) > 0) {
+    e = order_ddf(rest, f2deg(rest));
+    order = order / gcd(order, e) * e;
+  }
+
+  while (f2expmod(m, 2, order) != 1)
+    order <<= 1;
+  return order;
+}
+
+/**
+ * \brief Primitivity test.
+ *
+ * \return 1 if m is primitive, that is if x generates 𝔽₂[x]/(m)*.
+ */
+int f2primitive(f2poly m)
+{
+  int n = f2deg(m);
+
+  if (n < 1) return 0;
+  return f2order(m) == (n == 64 ? UINT64_MAX : ((uint64_t) 1 << n) - 1);
+}
+
+
 /*
  * +---------------------+
  * | String Manipulation |
@@ -0,0 +1,52 @@
+#ifndef _BITMATRIX_H_
+#define _BITMATRIX_H_
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/*
+ * Dense matrices over 𝔽₂, one row after the other: bit j of word j/64 of a
+ * row holds the entry in column j. Rows are padded to stride words, with the
+ * padding bits kept at zero.
+ * Vectors are packed the same way, as by pack_bits().
+ */
+struct gf2matrix {
+  size_t rows;
+  size_t cols;
+  size_t stride;
+  uint64_t* data;
+};
+
+#define gf2m_row(m, i) ((m)->data + (size_t) (i) * (m)->stride)
+
+struct gf2matrix* gf2m_new(size_t rows, size_t cols);
+
+void gf2m_free(struct gf2matrix* m);
+
+struct gf2matrix* gf2m_copy(const struct gf2matrix* m);
+
+struct gf2matrix* gf2m_identity(size_t n);
+
+struct gf2matrix* gf2m_random(size_t rows, size_t cols);
+
+int gf2m_get(const struct gf2matrix* m, size_t i, size_t j);
+
+void gf2m_set(struct gf2matrix* m, size_t i, size_t j, int v);
+
+int gf2m_equal(const struct gf2matrix* a, const struct gf2matrix* b);
+
+struct gf2matrix* gf2m_mul(struct gf2matrix* c,
+                           const struct gf2matrix* a,
+                           const struct gf2matrix* b);
+
+uint64_t* gf2m_mulvec(uint64_t* y, const struct gf2matrix* a, const uint64_t* x);
+
+size_t gf2m_echelon(struct gf2matrix* m, int full);
+
+size_t gf2m_rank(const struct gf2matrix* m);
+
+long gf2m_solve(uint64_t* x, const struct gf2matrix* a, const uint64_t* b);
+
+struct gf2matrix* gf2m_inverse(struct gf2matrix* dest, const struct gf2matrix* a);
+
+#endif /* _BITMATRIX_H_ */
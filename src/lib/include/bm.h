@@ -0,0 +1,13 @@
+#ifndef _BM_H_
+#define _BM_H_
+
+#include <stdint.h>
+#include <stdlib.h>
+
+uint64_t* pack_bits(uint64_t* dest, const char* bits, size_t n);
+
+size_t linear_complexity(const uint64_t* s, size_t n, size_t* profile);
+
+size_t connection_polynomial(const uint64_t* s, size_t n, uint64_t* poly);
+
+#endif /* _BM_H_ */
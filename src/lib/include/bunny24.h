@@ -1,9 +1,15 @@
 #ifndef _BUNNY24_H_
 #define _BUNNY24_H_
 
+#include <stdint.h>
 #include <stdlib.h>
 #include "field.h"
 
+/* Round keys of bunny24, each packed as a 24-bit word. */
+struct bunny24_key {
+  uint32_t rk[16];
+};
+
 int8 insbox(int i, int8 v);
 
 char* cxor(char* dest, const char* a, const char* b);
@@ -31,6 +37,11 @@ char* bunny24_encrypt(char* dest,
                       const char* key,
                       const char* message);
 
+struct bunny24_key* bunny24_setkey(struct bunny24_key* k, const char* key);
+uint32_t bunny24_encrypt_block(const struct bunny24_key* k, uint32_t block);
+uint32_t* bunny24_ctr_blocks(const struct bunny24_key* k, uint32_t* restrict dest,
+                             uint32_t ctr, size_t n);
+
 char* reduced_bunny24_encrypt(char *dest,
                               const char *key,
                               const char *message);
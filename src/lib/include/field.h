@@ -20,4 +20,27 @@ int8 btoi(const char* s);
 
 char* ptos(int8 n);
 
+
+/*
+ * Polynomials over 𝔽₂ of degree up to 127: bit i holds the coefficient of xⁱ.
+ * Moduli shall have degree at most 64.
+ */
+typedef unsigned __int128 f2poly;
+
+int f2deg(f2poly a);
+
+f2poly f2mod(f2poly a, f2poly m);
+
+f2poly f2mulmod(f2poly m, f2poly a, f2poly b);
+
+f2poly f2expmod(f2poly m, f2poly a, uint64_t e);
+
+f2poly f2gcd(f2poly a, f2poly b);
+
+int f2irreducible(f2poly m);
+
+uint64_t f2order(f2poly m);
+
+int f2primitive(f2poly m);
+
 #endif
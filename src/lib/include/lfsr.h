@@ -1,5 +1,6 @@
 #ifndef _LFSR_H_
 #define _LFSR_H_
+#include <stdint.h>
 #include <stdlib.h>
 
 char *LFSR(char* dest,
@@ -10,10 +11,95 @@ char *LFSR(char* dest,
 
 unsigned int lfsr_period(char*, size_t);
 
+uint64_t lfsr_order(const char* p, size_t len);
+
+uint64_t* lfsr_key_loading(uint64_t* states, const char* keys, size_t count);
+
+char* lfsr_jump(char* reg, const char* p, size_t len, uint64_t n);
+
+size_t lfsr_degree(size_t j);
+
+uint64_t* lfsr_output(uint64_t* dest, size_t j, uint64_t state, size_t n);
+
+/*
+ * Keyed generators: the states of the registers, packed into words, as the
+ * keystream goes on, and the room their regular sequences take over a chunk
+ * of LFSR_CHUNK_STEPS steps, reused from call to call.
+ */
+#define LFSR_CHUNK_STEPS (1 << 16)
+#define LFSR_SEQ_BYTES (LFSR_CHUNK_STEPS/8 + 64)
+
+struct maj5_ctx {
+  uint64_t states[5];
+  unsigned char seqs[5][LFSR_SEQ_BYTES];
+};
+
+struct all5_ctx {
+  uint64_t states[5];
+  unsigned char seqs[5][LFSR_SEQ_BYTES];
+};
+
+struct a5_1_ctx {
+  uint64_t states[3];
+  unsigned char seqs[3][LFSR_SEQ_BYTES];
+};
+
 char* maj5(char* dest, const char* key, const size_t n);
 
 char* all5(char* dest, const char* key, const size_t n);
 
+char* all5_seek(char* dest, const char* key, uint64_t offset, size_t n);
+
+char* all5_parallel(char* dest, const char* key, size_t n, int threads);
+
 char* a5_1(char* dest, const char* key, const size_t n);
 
+unsigned char* maj5_bytes(unsigned char* dest, const char* key, size_t n);
+
+unsigned char* all5_bytes(unsigned char* dest, const char* key, size_t n);
+
+unsigned char* a5_1_bytes(unsigned char* dest, const char* key, size_t n);
+
+struct maj5_ctx* maj5_init(struct maj5_ctx* ctx, const char* key);
+char* maj5_next(struct maj5_ctx* ctx, char* dest, size_t n);
+unsigned char* maj5_next_bytes(struct maj5_ctx* ctx, unsigned char* dest, size_t n);
+
+struct all5_ctx* all5_init(struct all5_ctx* ctx, const char* key);
+char* all5_next(struct all5_ctx* ctx, char* dest, size_t n);
+unsigned char* all5_next_bytes(struct all5_ctx* ctx, unsigned char* dest, size_t n);
+
+struct a5_1_ctx* a5_1_init(struct a5_1_ctx* ctx, const char* key);
+char* a5_1_next(struct a5_1_ctx* ctx, char* dest, size_t n);
+unsigned char* a5_1_next_bytes(struct a5_1_ctx* ctx, unsigned char* dest, size_t n);
+
+enum stream_cipher {
+  STREAM_MAJ5,
+  STREAM_ALL5,
+  STREAM_A5_1,
+};
+
+struct stream_ctx {
+  enum stream_cipher cipher;
+  union {
+    struct maj5_ctx maj5;
+    struct all5_ctx all5;
+    struct a5_1_ctx a5_1;
+  } gen;
+};
+
+struct stream_ctx* stream_init(struct stream_ctx* ctx,
+                               enum stream_cipher cipher,
+                               const char* key);
+
+char* stream_xor(struct stream_ctx* ctx,
+                 char* dst,
+                 const char* src,
+                 size_t len);
+
+uint64_t* maj5_x64(uint64_t* dest, const char* keys, size_t n);
+
+uint64_t* all5_x64(uint64_t* dest, const char* keys, size_t n);
+
+uint64_t* a5_1_x64(uint64_t* dest, const char* keys, size_t n);
+
 #endif
@@ -0,0 +1,28 @@
+#ifndef _POOL_H_
+#define _POOL_H_
+
+#include <stdlib.h>
+#include <openssl/bn.h>
+
+/*
+ * A reservoir of random tokens, and of challenges r, r^e mod n for known
+ * clients, kept full by background threads. A NULL pool is valid everywhere,
+ * and always empty.
+ */
+struct pool;
+
+struct pool* pool_new(int bits, size_t capacity, int threads);
+
+void pool_free(struct pool* p);
+
+int pool_add_client(struct pool* p, const char* name,
+                    const BIGNUM* e, const BIGNUM* n);
+
+void pool_wait(struct pool* p);
+
+BIGNUM* pool_token(struct pool* p, BIGNUM** dest, int bits);
+
+int pool_challenge(struct pool* p, const char* name, int bits,
+                   const BIGNUM* e, const BIGNUM* n, BIGNUM** r, BIGNUM** c);
+
+#endif /* _POOL_H_ */
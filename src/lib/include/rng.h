@@ -1,15 +1,59 @@
 #ifndef _RNG_H_
 #define _RNG_H_
 
+#include <stdint.h>
 #include <stdlib.h>
 #include <openssl/bn.h>
 
+#include "bunny24.h"
+
+#define MT_N 624
+#define DRBG_BLOCKS 1024
+
+/* A Mersenne Twister (MT19937): seed once, then draw from it. */
+struct mt_ctx {
+  uint32_t state[MT_N];
+  size_t index;
+};
+
+struct mt_ctx* mt_init(struct mt_ctx* ctx, uint32_t seed);
+
+uint32_t mt_next(struct mt_ctx* ctx);
+
+uint32_t* mt_fill32(struct mt_ctx* ctx, uint32_t* dest, size_t n);
+
+unsigned char* mt_fill(struct mt_ctx* ctx, unsigned char* dest, size_t len);
+
+struct mt_ctx* mt_jump(struct mt_ctx* ctx, unsigned k);
+
+struct mt_ctx* mt_substreams(struct mt_ctx* ctxs, size_t n, uint32_t seed, unsigned k);
+
 char* frng(char* dest, const char* seed, size_t len);
 
+void* entropy(void* dest, size_t len);
+
+/* A bunny24-CTR generator: seed it from entropy() or by hand, then draw. */
+struct drbg_ctx {
+  struct bunny24_key key;
+  uint32_t nonce;
+  unsigned char buf[3 * DRBG_BLOCKS];
+  size_t left;
+  int reseeds;
+  size_t since_reseed;
+};
+
+struct drbg_ctx* drbg_init(struct drbg_ctx* ctx);
+
+struct drbg_ctx* drbg_seed(struct drbg_ctx* ctx, const char* seed);
+
+void* drbg_generate(struct drbg_ctx* ctx, void* dest, size_t len);
+
 char* srng(char* dest, const char* seed, size_t len);
 
 BIGNUM* bn_rng(BIGNUM** n, int bits);
 
 BIGNUM* prng(BIGNUM** dest, int bits);
 
+BIGNUM* safe_prng(BIGNUM** dest, int bits, int threads);
+
 #endif /* _RNG_H_ */
@@ -1,14 +1,76 @@
 #ifndef _RSA_H_
 #define _RSA_H_
 
+#include <stdint.h>
 #include <openssl/bn.h>
 
+#if defined(__SIZEOF_INT128__) && BN_BITS2 == 64
+#define RSA_NATIVE64
+#endif
+
+/* The Montgomery form of an odd modulus of at most 64 bits; n = 0 if none. */
+struct mont64 {
+  uint64_t n;
+  uint64_t ninv;  /* -n⁻¹ mod 2⁶⁴ */
+  uint64_t r2;    /* 2¹²⁸ mod n */
+};
+
+int mont64_set(struct mont64* k, const BIGNUM* n);
+
+int mont64_exp(BIGNUM* m, const BIGNUM* e, const struct mont64* k);
 
 void rsa_encrypt(BIGNUM* m, const BIGNUM* e, const BIGNUM* n);
 
 #define rsa_decrypt(m, e, n) rsa_encrypt(m, e, n)
 
-void rsa_genkey(int bits,
-                BIGNUM* n, BIGNUM* phi, BIGNUM* e, BIGNUM* d);
+/* A private key in CRT form, for n = pq. */
+struct rsa_crt {
+  BIGNUM* p;
+  BIGNUM* q;
+  BIGNUM* dp;
+  BIGNUM* dq;
+  BIGNUM* qinv;
+  BN_MONT_CTX* mont_p;
+  BN_MONT_CTX* mont_q;
+};
+
+struct rsa_crt* rsa_crt_load(BIGNUM* p, BIGNUM* q,
+                             BIGNUM* dp, BIGNUM* dq, BIGNUM* qinv);
+
+struct rsa_crt* rsa_crt_new(const BIGNUM* p, const BIGNUM* q, const BIGNUM* d);
+
+void rsa_crt_free(struct rsa_crt* k);
+
+void rsa_crt_decrypt(BIGNUM* m, const struct rsa_crt* k);
+
+/*
+ * A key loaded once and used for many exponentiations: the exponent e, public
+ * or private, the modulus n, and its Montgomery form, with a BN_CTX reused by
+ * every call. Not to be shared between threads.
+ */
+struct rsa_key_ctx {
+  BIGNUM* e;
+  BIGNUM* n;
+  struct rsa_crt* crt;
+  BN_MONT_CTX* mont;
+  struct mont64 m64;
+  BN_CTX* ctx;
+};
+
+struct rsa_key_ctx* rsa_key_new(const BIGNUM* e, const BIGNUM* n,
+                                struct rsa_crt* crt);
+
+int rsa_key_set(struct rsa_key_ctx** k, const BIGNUM* e, const BIGNUM* n);
+
+void rsa_key_free(struct rsa_key_ctx* k);
+
+void rsa_key_exp(BIGNUM* m, struct rsa_key_ctx* k);
+
+void rsa_genkey_parallel(int threads, int bits,
+                         BIGNUM* n, BIGNUM* phi, BIGNUM* e, BIGNUM* d,
+                         struct rsa_crt** crt);
+
+#define rsa_genkey(bits, n, phi, e, d) \
+  rsa_genkey_parallel(1, bits, n, phi, e, d, NULL)
 
 #endif
@@ -0,0 +1,12 @@
+#ifndef _VECTORIZE_H_
+#define _VECTORIZE_H_
+
+/*
+ * For the few data-parallel loops that take all the time: have them
+ * vectorized even at -O2, with an AVX2 clone picked at load time where
+ * available.
+ */
+#define VECTORIZE __attribute__((target_clones("avx2", "default"), \
+                                 optimize("tree-vectorize")))
+
+#endif /* _VECTORIZE_H_ */
@@ -8,12 +8,17 @@
  * + \ref all5()
  * + \ref a5_1()
  *
+ * each also in a bitsliced version running 64 keys at once.
  */
 
 #include <assert.h>
+#include <endian.h>
+#include <pthread.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "field.h"
 #include "lfsr.h"
 
 
@@ -39,11 +44,6 @@ static char update(const char* p, size_t degree, char* state)
   return b;
 }
 
-static char output(char* state, size_t degree)
-{
-  return state[degree-1];
-}
-
 
 /**
  * \brief Implementation of a lfsr register.
@@ -113,6 +113,455 @@ unsigned int lfsr_period(char* p, size_t len)
 }
 
 
+/*
+ * +-------------------------+
+ * | Packed Register Engine  |
+ * +-------------------------+
+ */
+
+/*
+ * The ciphers below keep each register packed into a machine word: bit i holds
+ * state[i] of the representation used by update(), so that clocking becomes a
+ * shift and the feedback bit the parity of the tapped bits.
+ */
+#define MASK(degree) \
+  ((degree) == 64 ? ~(uint64_t) 0 : ((uint64_t) 1 << (degree)) - 1)
+
+static const char* frame = "\0\0\1\0\1\1\0\0\1\0\0\0\0\0\0\0\0\0\0\0\0\0";
+static const size_t degrees[5] = {19, 22, 23, 11, 13};
+/** Position of the clock bit in each register. */
+static const size_t clocks[5] = {8, 10, 10, 4, 6};
+/**
+ * Array of polynomials to be used per each registers.
+ * A5/1 uses only the first three of them.
+ */
+static const char* polys[5] = {
+  /* p = x^19 + x^18 + x^17 + x^14 + 1 */
+  "\1\0\0\0\0\0\0\0\0\0\0\0\0\0\1\0\0\1\1\1",
+  /* p = x^22 + x^21 + 1 */
+  "\1\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\1\1",
+  /* p = x^23 + x^22 + x^21 + x^8 + 1 */
+  "\1\0\0\0\0\0\0\0\1\0\0\0\0\0\0\0\0\0\0\0\0\1\1\1",
+  /* p = x^11 + x^2 + 1 */
+  "\1\0\1\0\0\0\0\0\0\0\0\1",
+  /* p = x^13 + x^4 + x^3 + x + 1 */
+  "\1\1\0\1\1\0\0\0\0\0\0\0\0\1",
+};
+
+static uint64_t pack_poly(const char* p, size_t degree)
+{
+  uint64_t taps;
+  size_t i;
+
+  for (i=taps=0; i!=degree; i++)
+    if (p[i+1]) taps |= (uint64_t) 1 << i;
+  return taps;
+}
+
+static void pack_polys(uint64_t* taps, size_t n)
+{
+  size_t j;
+
+  for (j=0; j!=n; j++)
+    taps[j] = pack_poly(polys[j], degrees[j]);
+}
+
+static inline uint64_t pupdate(uint64_t state, uint64_t taps, size_t degree)
+{
+  return ((state << 1) | __builtin_parityll(state & taps)) & MASK(degree);
+}
+
+static uint64_t pack_register(const char* reg, size_t degree)
+{
+  uint64_t state;
+  size_t i;
+
+  for (i=state=0; i!=degree; i++)
+    if (reg[i]) state |= (uint64_t) 1 << i;
+  return state;
+}
+
+
+/*
+ * +------------+
+ * | Jump Ahead |
+ * +------------+
+ */
+
+/**
+ * \brief Characteristic polynomial of a register.
+ *
+ * Outputs satisfy aₜ = Σₖ p[k]·aₜ₋ₖ, hence the transition map of the register
+ * is annihilated by the reciprocal of p, C(x) = Σₖ p[k]·x^(degree-k).
+ */
+static f2poly charpoly(uint64_t taps, size_t degree)
+{
+  f2poly c;
+  size_t k;
+
+  c = (f2poly) 1 << degree;
+  for (k=1; k<=degree; k++)
+    if (taps >> (k-1) & 1) c |= (f2poly) 1 << (degree-k);
+  return c;
+}
+
+/**
+ * \brief Clocks a packed register n times, in O(degree² log n).
+ *
+ * Being r(x) = xⁿ mod C(x), the n-th power of the transition map M equals
+ * r(M): the new state is the sum of the states Mⁱs for which rᵢ = 1, and
+ * these are just the first \ref degree states.
+ */
+static uint64_t pjump(uint64_t state, uint64_t taps, size_t degree, uint64_t n)
+{
+  f2poly r;
+  uint64_t jumped;
+  size_t i;
+
+  r = f2expmod(charpoly(taps, degree), 2, n);
+  for (i=jumped=0; i!=degree; i++) {
+    if (r >> i & 1) jumped ^= state;
+    state = pupdate(state, taps, degree);
+  }
+
+  return jumped;
+}
+
+/**
+ * \brief Random access to the states of a register.
+ *
+ * Brings \ref reg to the state it would reach after n calls to \ref LFSR(),
+ * without walking through all the intermediate ones.
+ *
+ * \param reg the register to be updated, of length len ≤ 64.
+ * \param p polynomial vector for updating the registers.
+ * \param len degree of the polynomial.
+ * \param n the number of steps to jump.
+ *
+ * \return reg
+ */
+char* lfsr_jump(char* reg, const char* p, size_t len, uint64_t n)
+{
+  uint64_t state;
+  size_t i;
+
+  assert(len <= 64);
+  state = pjump(pack_register(reg, len), pack_poly(p, len), len, n);
+  for (i=0; i!=len; i++)
+    reg[i] = state >> i & 1;
+
+  return reg;
+}
+
+/**
+ * \brief Period of a register, from the multiplicative order of x.
+ *
+ * Every non-zero state of the register has period dividing the order of x
+ * modulo C(x), and the state {0, …, 0, 1} used by \ref lfsr_period() attains
+ * it. Takes milliseconds for degrees up to 64, where \ref lfsr_period() walks
+ * through up to 2^len states.
+ *
+ * \param p the polynomial to be analyzed, with p[len] = 1.
+ * \param len the degree of `p`, at most 64.
+ *
+ * \return the period, or 0 if p[len] = 0 and the register is not invertible.
+ */
+uint64_t lfsr_order(const char* p, size_t len)
+{
+  assert(len <= 64);
+  return f2order(charpoly(pack_poly(p, len), len));
+}
+
+
+/*
+ * +-----------------+
+ * | Register Access |
+ * +-----------------+
+ */
+
+/**
+ * \brief Degree of the j-th register of the ciphers, 0 ≤ j < 5.
+ */
+size_t lfsr_degree(size_t j)
+{
+  assert(j < 5);
+  return degrees[j];
+}
+
+/**
+ * \brief Regular output sequence of the j-th register of the ciphers.
+ *
+ * Meant for attacks working one register at a time: the keystream of
+ * \ref all5() at step t combines the t-th outputs of its five registers.
+ *
+ * \param dest destination, of at least n/64 + 1 words: bit t of word t/64 is
+ *             the output after t clocks, as in \ref pack_bits().
+ * \param j the register, 0 ≤ j < 5.
+ * \param state packed state of the register, as in struct all5_ctx.
+ * \param n length of the sequence.
+ *
+ * \return dest
+ */
+uint64_t* lfsr_output(uint64_t* dest, size_t j, uint64_t state, size_t n)
+{
+  uint64_t taps;
+  size_t t;
+
+  assert(j < 5);
+  taps = pack_poly(polys[j], degrees[j]);
+  memset(dest, 0, (n/64 + 1) * sizeof(uint64_t));
+  for (t=0; t!=n; t++) {
+    dest[t/64] |= (state >> (degrees[j]-1) & 1) << (t%64);
+    state = pupdate(state, taps, degrees[j]);
+  }
+
+  return dest;
+}
+
+
+/*
+ * +----------------------------+
+ * | Lookahead Clocking Engine  |
+ * +----------------------------+
+ */
+
+/*
+ * Clocking a register regularly produces a fixed sequence of output bits;
+ * irregular clocking only decides how far each register has gone along its
+ * own sequence. Hence, each register is expanded into its regular sequence,
+ * and the generators just keep a position in it: the output bit of register j
+ * is the first bit of a window starting at that position, and its clock bit
+ * lies offsets[j] = degrees[j]-1-clocks[j] bits further.
+ *
+ * Clocking decisions are taken k steps at a time (\ref MAJ5_LOOKAHEAD,
+ * \ref A5_1_LOOKAHEAD): the next k bits of each clock window are gathered
+ * into an index for a precomputed table, holding per each register which of
+ * the k steps move it, and how far it advances overall.
+ */
+#define MAJ5_LOOKAHEAD 2
+#define A5_1_LOOKAHEAD 4
+/* steps between two reloads of the windows, leaving room for the clock bits. */
+#define WINDOW_STEPS 48
+
+/* degrees[j]-1-clocks[j], with clock bits in positions 8, 10, 10, 4, 6 */
+static const size_t offsets[5] = {10, 11, 12, 6, 6};
+
+/**
+ * Majority clocking for five registers: indexed by the clock bits (bit j is
+ * the clock bit of register j), holds the set of registers agreeing with the
+ * majority, that is, the ones to be updated.
+ */
+static const unsigned char maj5_moves[32] = {
+  0x1f, 0x1e, 0x1d, 0x1c, 0x1b, 0x1a, 0x19, 0x07,
+  0x17, 0x16, 0x15, 0x0b, 0x13, 0x0d, 0x0e, 0x0f,
+  0x0f, 0x0e, 0x0d, 0x13, 0x0b, 0x15, 0x16, 0x17,
+  0x07, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f,
+};
+
+/** Same as \ref maj5_moves, for the three registers of A5/1. */
+static const unsigned char a5_1_moves[8] = {
+  0x7, 0x6, 0x5, 0x3, 0x3, 0x5, 0x6, 0x7,
+};
+
+/*
+ * Lookahead tables. Entries hold, in bits [k*j, k*j+k), which of the k
+ * steps move register j, and in bits [16+3*j, 16+3*j+3) how many they are.
+ */
+static uint32_t maj5_lookahead[1 << (5*MAJ5_LOOKAHEAD)];
+static uint32_t a5_1_lookahead[1 << (3*A5_1_LOOKAHEAD)];
+/*
+ * Indexed by the moves of a register over (at most) four steps, and by the
+ * first four bits of its window, holds its output bits over those steps.
+ */
+static unsigned char expand[256];
+/** Bytes with the bit order reversed, for packed output. */
+static unsigned char reversed[256];
+static pthread_once_t lookahead_once = PTHREAD_ONCE_INIT;
+
+static void fill_lookahead(uint32_t* table,
+                           const unsigned char* moves,
+                           size_t n,
+                           size_t k)
+{
+  size_t index, s, j;
+  size_t advance[5];
+  unsigned int clock;
+
+  for (index=0; index != (size_t) 1 << (n*k); index++) {
+    table[index] = 0;
+    for (j=0; j!=n; j++) advance[j] = 0;
+
+    for (s=0; s!=k; s++) {
+      for (j=clock=0; j!=n; j++)
+        clock |= (index >> (k*j + advance[j]) & 1) << j;
+      for (j=0; j!=n; j++)
+        if (moves[clock] >> j & 1) {
+          table[index] |= 1 << (k*j + s);
+          advance[j]++;
+        }
+    }
+    for (j=0; j!=n; j++)
+      table[index] |= advance[j] << (16 + 3*j);
+  }
+}
+
+static void lookahead_init(void)
+{
+  size_t index, s, a;
+
+  fill_lookahead(maj5_lookahead, maj5_moves, 5, MAJ5_LOOKAHEAD);
+  fill_lookahead(a5_1_lookahead, a5_1_moves, 3, A5_1_LOOKAHEAD);
+  for (index=0; index!=256; index++) {
+    for (s=a=0; s!=4; a += index >> (4+s) & 1, s++)
+      expand[index] |= (index >> a & 1) << s;
+    for (s=0; s!=8; s++)
+      reversed[index] |= (index >> s & 1) << (7-s);
+  }
+}
+
+/**
+ * \brief Regular output sequence of a register.
+ *
+ * Bit m of the returned buffer is the output of the register after m clocks.
+ * The first bytes are computed clocking the register; afterwards, since
+ * p(x)⁸ = p(x⁸) over 𝔽₂, the same recurrence holds between bytes, and the
+ * sequence is extended a byte at a time.
+ *
+ * \param seq room for len/8 + degree + 16 bytes, as in the contexts.
+ * \param len number of bits needed; some more are computed for windows.
+ * \return seq
+ */
+static unsigned char* sequence(unsigned char* seq,
+                               uint64_t state,
+                               uint64_t taps,
+                               size_t degree,
+                               size_t len)
+{
+  size_t i, bytes;
+  uint64_t t;
+
+  bytes = len/8 + degree + 16;
+  assert(bytes <= LFSR_SEQ_BYTES);
+  memset(seq, 0, bytes);
+
+  /* the register holds the first outputs, the last one in first position */
+  for (i=0; i!=degree; i++)
+    seq[i/8] |= (state >> (degree-1-i) & 1) << (i%8);
+  for (; i != 8*degree; i++) {
+    state = pupdate(state, taps, degree);
+    seq[i/8] |= (state & 1) << (i%8);
+  }
+  for (i=degree; i!=bytes; i++)
+    for (t=taps; t; t &= t-1)
+      seq[i] ^= seq[i - __builtin_ctzll(t) - 1];
+
+  return seq;
+}
+
+/** 64 bits of a sequence, starting from bit pos. */
+static inline uint64_t window(const unsigned char* seq, size_t pos)
+{
+  uint64_t w;
+
+  memcpy(&w, seq + pos/8, sizeof(uint64_t));
+  w = le64toh(w);
+  if (pos % 8)
+    w = w >> (pos%8) | (uint64_t) seq[pos/8 + 8] << (64 - pos%8);
+  return w;
+}
+
+/**
+ * \brief Runs a majority-clocked generator for len steps.
+ *
+ * \param dest      output bits, one per byte, or packed eight per byte, the
+ *                  first one in the most significant bit.
+ * \param seqs      regular sequences of the n registers.
+ * \param pos[in,out] position of each register along its sequence.
+ * \param k         steps resolved per lookup in \ref lookahead; it divides 8.
+ * \param packed    whether the output shall be packed.
+ */
+static inline void clocked_run(char* dest,
+                               size_t len,
+                               unsigned char** seqs,
+                               size_t* pos,
+                               size_t n,
+                               size_t k,
+                               const uint32_t* lookahead,
+                               const unsigned char* moves,
+                               int packed)
+{
+  uint64_t w[5] = {0};
+  size_t p[5];
+  const unsigned char* seq[5];
+  size_t i, j, s, step;
+  unsigned int index, out, advance, byte;
+  uint32_t entry;
+  const unsigned int kmask = (1 << k) - 1;
+
+  /*
+   * local copies, as stores to dest may alias anything; loops over registers
+   * are unrolled, so that windows are kept in registers.
+   */
+  for (j=0; j!=n; j++) {
+    seq[j] = seqs[j];
+    p[j] = pos[j];
+  }
+
+  /* bits of the current output byte, first one in the least significant */
+  byte = 0;
+  for (i=0; i + k <= len; ) {
+#pragma GCC unroll 5
+    for (j=0; j!=n; j++) w[j] = window(seq[j], p[j]);
+
+    for (step=0; step + k <= WINDOW_STEPS && i + k <= len; step += k, i += k) {
+#pragma GCC unroll 5
+      for (j=index=0; j!=n; j++)
+        index |= (w[j] >> offsets[j] & kmask) << (k*j);
+      entry = lookahead[index];
+#pragma GCC unroll 5
+      for (j=out=0; j!=n; j++) {
+        out ^= expand[(entry >> (k*j) & kmask) << 4 | (w[j] & 0xf)];
+        advance = entry >> (16 + 3*j) & 7;
+        w[j] >>= advance;
+        p[j] += advance;
+      }
+      if (packed) {
+        byte |= (out & kmask) << (i%8);
+        if ((i+k) % 8 == 0) {
+          dest[i/8] = reversed[byte];
+          byte = 0;
+        }
+      } else {
+#pragma GCC unroll 4
+        for (s=0; s!=k; s++)
+          dest[i+s] = out >> s & 1;
+      }
+    }
+  }
+
+  /* fewer than k steps are left: take them one by one */
+  for (; i != len; i++) {
+    for (j=index=out=0; j!=n; j++) {
+      w[j] = window(seq[j], p[j]);
+      index |= (w[j] >> offsets[j] & 1) << j;
+      out ^= w[j] & 1;
+    }
+    for (j=0; j!=n; j++)
+      p[j] += moves[index] >> j & 1;
+    if (packed) {
+      byte |= out << (i%8);
+      if (i%8 == 7 || i+1 == len) {
+        dest[i/8] = reversed[byte];
+        byte = 0;
+      }
+    } else
+      dest[i] = out;
+  }
+
+  for (j=0; j!=n; j++)
+    pos[j] = p[j];
+}
+
 
 /*
  * +--------------------+
@@ -120,64 +569,198 @@ unsigned int lfsr_period(char* p, size_t len)
  * +--------------------+
  */
 
+/*
+ * Key loading is linear: clocking a register regularly is a linear map, and
+ * key and frame bits are just xored in. Hence the final state of register j
+ * is frame_states[j], the contribution of the frame, xored with one
+ * contribution per key bit, and these are gathered eight at a time in
+ * key_tables[j][b], indexed by the b-th byte of the key.
+ */
+static uint32_t key_tables[5][8][256];
+static uint32_t frame_states[5];
+static uint64_t packed_taps[5];
+static pthread_once_t key_once = PTHREAD_ONCE_INIT;
+
+static void key_tables_init(void)
+{
+  uint64_t* taps = packed_taps;
+  uint64_t column[64];
+  uint64_t state;
+  size_t i, j, b, v;
+
+  pack_polys(taps, 5);
+  for (j=0; j!=5; j++) {
+    for (state=i=0; i!=22; i++)
+      state = pupdate(state, taps[j], degrees[j]) ^ frame[i];
+    frame_states[j] = state;
+
+    /* key bit i is followed by 63-i more key bits and 22 frame bits */
+    for (state=1, i=0; i!=22; i++)
+      state = pupdate(state, taps[j], degrees[j]);
+    for (i=64; i-- > 0; ) {
+      column[i] = state;
+      state = pupdate(state, taps[j], degrees[j]);
+    }
+
+    for (b=0; b!=8; b++)
+      for (v=1; v!=256; v++)
+        key_tables[j][b][v] = key_tables[j][b][v & (v-1)] ^
+          column[8*b + __builtin_ctz(v)];
+  }
+}
+
+/** Packs a key of 64 bytes, one bit each, into a word: bit i is key[i]. */
+static inline uint64_t pack_key(const char* key)
+{
+  uint64_t k, x;
+  size_t b;
+
+  for (k=b=0; b!=8; b++) {
+    memcpy(&x, key + 8*b, sizeof(uint64_t));
+    x = le64toh(x) & 0x0101010101010101;
+    k |= (x * 0x0102040810204080 >> 56) << (8*b);
+  }
+  return k;
+}
+
 /**
  * \brief A5/1 Key Loading algorithm.
  *
+ * Registers are cleared, then clocked regularly 64 times xoring the key bits,
+ * and 22 times xoring the \ref frame bits, in their first position.
+ * The whole process is replaced by eight table lookups per register, see
+ * \ref key_tables.
  *
+ * \param states[out] packed registers to be warmed up.
  * \param key 64-byte key to be used for the cipher.
- * \param frame 22-byte initial vector used for the cipher.
- * \param polynomials array of polynomials to be used per each registers
- * \param degreees degrees per each polynomial
- * \param n number of polynomials to be used
- *          (length of degrees[], polynomials[], and registers[]).
+ * \param n number of registers to be used (length of states[]).
+ */
+static void key_loading(uint64_t* states, const char* key, const size_t n)
+{
+  uint64_t k;
+  size_t j, b;
+
+  pthread_once(&key_once, key_tables_init);
+  k = pack_key(key);
+  for (j=0; j!=n; j++)
+    for (states[j]=frame_states[j], b=0; b!=8; b++)
+      states[j] ^= key_tables[j][b][k >> (8*b) & 0xff];
+}
+
+/**
+ * \brief Key loading for many keys at once.
  *
- * \return states to be warmed up.
+ * \param states[out] five packed registers per key, in the representation of
+ *                    \ref LFSR(): bit i of the word holds reg[i].
+ * \param keys count consecutive keys, of 64 bytes each.
+ * \param count number of keys.
+ *
+ * \return states
  */
-static char** key_loading(const char* key,
-                          const char* frame,
-                          const char** polynomials,
-                          const size_t*  degrees,
-                          const size_t n)
+uint64_t* lfsr_key_loading(uint64_t* states, const char* keys, size_t count)
 {
-  size_t i, j;
-  char** registers;
+  size_t i;
 
-  registers = (char**) malloc(sizeof(char*) * n);
-  for (i=0; i!=n; i++)
-    registers[i] = calloc(degrees[i], sizeof(char));
+  for (i=0; i!=count; i++)
+    key_loading(states + 5*i, keys + 64*i, 5);
+  return states;
+}
 
-  for (i=0; i!=64; i++)
-    for (j=0; j!=n; j++) {
-      update(polynomials[j], degrees[j], registers[j]);
-      registers[j][0] ^= key[i];
-    }
+/*
+ * Contexts keep the packed registers between calls: each call expands them
+ * into their regular sequences, in the room the context has for them, at most
+ * LFSR_CHUNK_STEPS steps at a time, runs the generator, and reads the new
+ * states back from the sequences.
+ */
 
-  for (i=0; i!=22; i++)
-    for (j=0; j!=n; j++) {
-      update(polynomials[j], degrees[j], registers[j]);
-      registers[j][0] ^= frame[i];
-    }
+static inline uint64_t rev64(uint64_t x)
+{
+  x = (x >> 1 & 0x5555555555555555) | (x & 0x5555555555555555) << 1;
+  x = (x >> 2 & 0x3333333333333333) | (x & 0x3333333333333333) << 2;
+  x = (x >> 4 & 0x0f0f0f0f0f0f0f0f) | (x & 0x0f0f0f0f0f0f0f0f) << 4;
+  return __builtin_bswap64(x);
+}
 
-  return registers;
+/** State of a register after pos clocks, read back from its sequence. */
+static inline uint64_t state_at(const unsigned char* seq,
+                                size_t pos,
+                                size_t degree)
+{
+  /* the register holds the next outputs, the last one in first position */
+  return rev64(window(seq, pos)) >> (64 - degree);
 }
 
-static void a5_1_update(const char** polynomials,
-                        const size_t* degrees,
-                        char** registers)
+/**
+ * \brief Runs a majority-clocked generator for len steps, from the packed
+ * states of its registers, and updates them.
+ */
+static inline void clocked_states(uint64_t* states,
+                                  unsigned char (*bufs)[LFSR_SEQ_BYTES],
+                                  char* dest,
+                                  size_t len,
+                                  size_t n,
+                                  size_t k,
+                                  const uint32_t* lookahead,
+                                  const unsigned char* moves,
+                                  int packed)
+{
+  unsigned char* seqs[5];
+  size_t pos[5];
+  size_t j, step;
 
+  for (; len; len -= step) {
+    step = len < LFSR_CHUNK_STEPS ? len : LFSR_CHUNK_STEPS;
+    for (j=0; j!=n; j++) {
+      seqs[j] = sequence(bufs[j], states[j], packed_taps[j], degrees[j], step);
+      pos[j] = 0;
+    }
+    clocked_run(dest, step, seqs, pos, n, k, lookahead, moves, packed);
+    for (j=0; j!=n; j++)
+      states[j] = state_at(seqs[j], pos[j], degrees[j]);
+    dest += packed ? step/8 : step;
+  }
+}
+
+/**
+ * \brief Sets up an A5/1 context: loads the key and warms the registers up.
+ *
+ * \param key 64-byte key to be used for the cipher.
+ *
+ * \return ctx
+ */
+struct a5_1_ctx* a5_1_init(struct a5_1_ctx* ctx, const char* key)
 {
-  size_t j;
-  char may_update;
-  static const size_t clocks[] = {8, 10, 10};
+  char warmup[100];
 
-  /* update using the majority function */
-  for (j=may_update=0; j!=3; j++)
-    if (registers[j][clocks[j]]) may_update++;
-  may_update = (may_update > 1);
-  for (j=0; j!=3; j++)
-    if (registers[j][clocks[j]] == may_update)
-      update(polynomials[j], degrees[j], registers[j]);
+  pthread_once(&lookahead_once, lookahead_init);
+  key_loading(ctx->states, key, 3);
+  clocked_states(ctx->states, ctx->seqs, warmup, 100, 3, A5_1_LOOKAHEAD,
+                 a5_1_lookahead, a5_1_moves, 0);
+  return ctx;
+}
 
+/**
+ * \brief Next n bits of A5/1 keystream, one per byte.
+ *
+ * \return dest
+ */
+char* a5_1_next(struct a5_1_ctx* ctx, char* dest, size_t n)
+{
+  clocked_states(ctx->states, ctx->seqs, dest, n, 3, A5_1_LOOKAHEAD,
+                 a5_1_lookahead, a5_1_moves, 0);
+  return dest;
+}
+
+/**
+ * \brief Next n bytes of A5/1 keystream, packed as in \ref a5_1_bytes().
+ *
+ * \return dest
+ */
+unsigned char* a5_1_next_bytes(struct a5_1_ctx* ctx, unsigned char* dest, size_t n)
+{
+  clocked_states(ctx->states, ctx->seqs, (char*) dest, 8*n, 3,
+                 A5_1_LOOKAHEAD, a5_1_lookahead, a5_1_moves, 1);
+  return dest;
 }
 
 /**
@@ -191,41 +774,24 @@ static void a5_1_update(const char** polynomials,
  */
 char* a5_1(char* dest, const char* key, const size_t n)
 {
-  char** states;
-  size_t i;
-  size_t j;
-
-  static const char* frame = "\0\0\1\0\1\1\0\0\1\0\0\0\0\0\0\0\0\0\0\0\0\0";
-  static const size_t degrees[5] = {19, 22, 23, 11, 13};
-  /**
-   * Array of polynomials to be used per each registers:
-   *   p₀ = x¹⁹ + x¹⁸ + x¹⁷ + x¹⁴ + 1
-   *   p₁ = x²² + x²¹ + 1
-   *   p₂ = x²³ + x²² + x²¹ + x⁸ + 1
-   */
-  static const char* polys[3] = {
-    "\1\0\0\0\0\0\0\0\0\0\0\0\0\0\1\0\0\1\1\1",
-    "\1\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\1\1",
-    "\1\0\0\0\0\0\0\0\1\0\0\0\0\0\0\0\0\0\0\0\0\1\1\1",
-  };
-
-  states = key_loading(key, frame, polys, degrees, 3);
-  for (i=0; i!=100; i++)
-    a5_1_update(polys, degrees, states);
-
-  for (i=0; i!=n; i++) {
-    /* compute output from all registers */
-    for (j = dest[i] = 0; j != 3; j++)
-      dest[i] ^= output(states[j], degrees[j]);
-    a5_1_update(polys, degrees, states);
+  struct a5_1_ctx ctx;
 
-  }
+  return a5_1_next(a5_1_init(&ctx, key), dest, n);
+}
 
-  for (i=0; i!=3; i++)
-    free(states[i]);
-  free(states);
+/**
+ * \brief The A5/1 stream cipher, packed output.
+ *
+ * Same as \ref a5_1(), with eight output bits per byte, the first one in the
+ * most significant bit.
+ *
+ * \param n     length of the output to be produced, in bytes.
+ */
+unsigned char* a5_1_bytes(unsigned char* dest, const char* key, size_t n)
+{
+  struct a5_1_ctx ctx;
 
-  return dest;
+  return a5_1_next_bytes(a5_1_init(&ctx, key), dest, n);
 }
 
 
@@ -236,26 +802,47 @@ char* a5_1(char* dest, const char* key, const size_t n)
  * +---------------------+
  */
 
-/*XXX. polynomials and degrees shall be global variables at this point. */
-char maj5_update(const char** polynomials,
-                 const size_t* degrees,
-                 char** registers)
+/**
+ * \brief Sets up a MAJ5 context: loads the key and warms the registers up.
+ *
+ * \param key a 64-bit key
+ *
+ * \return ctx
+ */
+struct maj5_ctx* maj5_init(struct maj5_ctx* ctx, const char* key)
 {
-  size_t j;
-  char may_update;
-  static const size_t clocks[] = {8, 10, 10, 4, 6};
+  char warmup[100];
 
-  /* update using the majority function */
-  for (j=may_update=0; j!=5; j++)
-    if (registers[j][clocks[j]]) may_update++;
-  may_update = (may_update > 2);
-  for (j=0; j!=5; j++)
-    if (registers[j][clocks[j]] == may_update)
-      update(polynomials[j], degrees[j], registers[j]);
+  pthread_once(&lookahead_once, lookahead_init);
+  key_loading(ctx->states, key, 5);
+  clocked_states(ctx->states, ctx->seqs, warmup, 100, 5, MAJ5_LOOKAHEAD,
+                 maj5_lookahead, maj5_moves, 0);
+  return ctx;
+}
 
-  return may_update;
+/**
+ * \brief Next n bits of MAJ5 keystream, one per byte.
+ *
+ * \return dest
+ */
+char* maj5_next(struct maj5_ctx* ctx, char* dest, size_t n)
+{
+  clocked_states(ctx->states, ctx->seqs, dest, n, 5, MAJ5_LOOKAHEAD,
+                 maj5_lookahead, maj5_moves, 0);
+  return dest;
 }
 
+/**
+ * \brief Next n bytes of MAJ5 keystream, packed as in \ref maj5_bytes().
+ *
+ * \return dest
+ */
+unsigned char* maj5_next_bytes(struct maj5_ctx* ctx, unsigned char* dest, size_t n)
+{
+  clocked_states(ctx->states, ctx->seqs, (char*) dest, 8*n, 5,
+                 MAJ5_LOOKAHEAD, maj5_lookahead, maj5_moves, 1);
+  return dest;
+}
 
 /**
  * \brief MAJ5 cipher.
@@ -269,41 +856,24 @@ char maj5_update(const char** polynomials,
  */
 char* maj5(char* dest, const char* key, const size_t n)
 {
-  char** states;
-  size_t i;
-  size_t j;
+  struct maj5_ctx ctx;
 
-  static const char* frame = "\0\0\1\0\1\1\0\0\1\0\0\0\0\0\0\0\0\0\0\0\0\0";
-  static const size_t degrees[5] = {19, 22, 23, 11, 13};
-  static const char* polys[5] = {
-    /* p = x^19 + x^18 + x^17 + x^14 + 1 */
-    "\1\0\0\0\0\0\0\0\0\0\0\0\0\0\1\0\0\1\1\1",
-    /* p = x^22 + x^21 + 1 */
-    "\1\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\1\1",
-    /* p = x^23 + x^22 + x^21 + x^8 + 1 */
-    "\1\0\0\0\0\0\0\0\1\0\0\0\0\0\0\0\0\0\0\0\0\1\1\1",
-    /*p = x^11 + x^2 + 1 */
-    "\1\0\1\0\0\0\0\0\0\0\0\1",
-    /* p = x^13 + x^4 + x^3 + x + 1 */
-    "\1\1\0\1\1\0\0\0\0\0\0\0\0\1",
-  };
-
-  states = key_loading(key, frame, polys, degrees, 5);
-  for (i=0; i!=100; i++)
-    maj5_update(polys, degrees, states);
-
-  for (i=0; i!=n; i++) {
-    /* compute output from all registers */
-    for (j = dest[i] = 0; j != 5; j++)
-      dest[i] ^= output(states[j], degrees[j]);
-    maj5_update(polys, degrees, states);
-  }
+  return maj5_next(maj5_init(&ctx, key), dest, n);
+}
 
-  for (i=0; i!=5; i++)
-    free(states[i]);
-  free(states);
+/**
+ * \brief MAJ5 cipher, packed output.
+ *
+ * Same as \ref maj5(), with eight output bits per byte, the first one in the
+ * most significant bit.
+ *
+ * \param n length of the output stream cipher, in bytes.
+ */
+unsigned char* maj5_bytes(unsigned char* dest, const char* key, size_t n)
+{
+  struct maj5_ctx ctx;
 
-  return dest;
+  return maj5_next_bytes(maj5_init(&ctx, key), dest, n);
 }
 
 
@@ -314,19 +884,111 @@ char* maj5(char* dest, const char* key, const size_t n)
  * +---------------------+
  */
 
-static void all5_update(const char** polynomials,
-                        const size_t* degrees,
-                        char** registers)
+/**
+ * \brief Runs ALL5 for n steps from the packed states of its registers, and
+ * updates them.
+ *
+ * Registers are clocked regularly, hence outputs are computed 64 at a time
+ * from the register sequences.
+ * Packed output requires n to be a multiple of 8.
+ */
+static void all5_states(uint64_t* states,
+                        unsigned char (*bufs)[LFSR_SEQ_BYTES],
+                        char* dest,
+                        size_t n,
+                        int packed)
 {
-  size_t i;
+  uint64_t x[5];
+  uint64_t out;
+  unsigned char* seqs[5];
+  size_t i, j, step;
+
+  for (; n; n -= step) {
+    step = n < LFSR_CHUNK_STEPS ? n : LFSR_CHUNK_STEPS;
+    for (j=0; j!=5; j++)
+      seqs[j] = sequence(bufs[j], states[j], packed_taps[j], degrees[j], step);
+
+    for (i=0; i<step; i+=64) {
+      for (j=0; j!=5; j++) x[j] = window(seqs[j], i);
+     /**
+      *  The output is computed using a semi-bent, balanced Boolean function
+      *  f: (𝔽₂)⁵ → 𝔽₂
+      *  (x₁,x₂,x₃,x₄,x₅) → x₁x₄ ⊕ x₂x₃ ⊕ x₂x₅ ⊕ x₃x₄
+      */
+      out = (x[0]&x[3]) ^ (x[1]&x[2]) ^ (x[1]&x[4]) ^ (x[2]&x[3]);
+      if (packed) {
+        /* first output in the most significant bit of each byte */
+        out = (out >> 1 & 0x5555555555555555) | (out & 0x5555555555555555) << 1;
+        out = (out >> 2 & 0x3333333333333333) | (out & 0x3333333333333333) << 2;
+        out = (out >> 4 & 0x0f0f0f0f0f0f0f0f) | (out & 0x0f0f0f0f0f0f0f0f) << 4;
+        out = htole64(out);
+        memcpy(dest + i/8, &out, step-i < 64 ? (step-i)/8 : 8);
+      } else
+        for (j=0; j!=64 && i+j!=step; j++)
+          dest[i+j] = out >> j & 1;
+    }
 
-  for (i=0; i!=5; i++)
-    update(polynomials[i], degrees[i], registers[i]);
+    for (j=0; j!=5; j++)
+      states[j] = state_at(seqs[j], step, degrees[j]);
+    dest += packed ? step/8 : step;
+  }
 }
 
+/**
+ * \brief Sets up an ALL5 context, at the given offset in the stream.
+ *
+ * Registers are clocked regularly, hence they jump straight past the warm-up
+ * and the first offset outputs.
+ */
+static struct all5_ctx* all5_init_at(struct all5_ctx* ctx,
+                                     const char* key,
+                                     uint64_t offset)
+{
+  size_t j;
+
+  key_loading(ctx->states, key, 5);
+  for (j=0; j!=5; j++)
+    ctx->states[j] = pjump(ctx->states[j], packed_taps[j], degrees[j],
+                           100 + offset);
+  return ctx;
+}
 
 /**
- * \brief MAJ5 cipher.
+ * \brief Sets up an ALL5 context: loads the key and warms the registers up.
+ *
+ * \param key a 64-bit key
+ *
+ * \return ctx
+ */
+struct all5_ctx* all5_init(struct all5_ctx* ctx, const char* key)
+{
+  return all5_init_at(ctx, key, 0);
+}
+
+/**
+ * \brief Next n bits of ALL5 keystream, one per byte.
+ *
+ * \return dest
+ */
+char* all5_next(struct all5_ctx* ctx, char* dest, size_t n)
+{
+  all5_states(ctx->states, ctx->seqs, dest, n, 0);
+  return dest;
+}
+
+/**
+ * \brief Next n bytes of ALL5 keystream, packed as in \ref all5_bytes().
+ *
+ * \return dest
+ */
+unsigned char* all5_next_bytes(struct all5_ctx* ctx, unsigned char* dest, size_t n)
+{
+  all5_states(ctx->states, ctx->seqs, (char*) dest, 8*n, 1);
+  return dest;
+}
+
+/**
+ * \brief ALL5 cipher.
  *
  * \param key a 64-bit key
  * \param n  length of the output stream cipher
@@ -337,46 +999,349 @@ static void all5_update(const char** polynomials,
  */
 char* all5(char* dest, const char* key, const size_t n)
 {
-  char outputs[5];
-  char** states;
+  struct all5_ctx ctx;
+
+  return all5_next(all5_init(&ctx, key), dest, n);
+}
+
+/**
+ * \brief ALL5 cipher, from a given offset.
+ *
+ * \param key a 64-bit key
+ * \param offset position, in the stream, of the first output bit.
+ * \param n  length of the output stream cipher
+ * \param dest the encrypted byte stream, of length n, not null-terminated.
+ *
+ * \return dest
+ */
+char* all5_seek(char* dest, const char* key, uint64_t offset, size_t n)
+{
+  struct all5_ctx ctx;
+
+  return all5_next(all5_init_at(&ctx, key, offset), dest, n);
+}
+
+/**
+ * \brief ALL5 cipher, packed output.
+ *
+ * Same as \ref all5(), with eight output bits per byte, the first one in the
+ * most significant bit.
+ *
+ * \param n length of the output stream cipher, in bytes.
+ */
+unsigned char* all5_bytes(unsigned char* dest, const char* key, size_t n)
+{
+  struct all5_ctx ctx;
+
+  return all5_next_bytes(all5_init(&ctx, key), dest, n);
+}
+
+
+struct all5_job {
+  char* dest;
+  const char* key;
+  uint64_t offset;
+  size_t n;
+};
+
+static void* all5_worker(void* arg)
+{
+  struct all5_job* job = arg;
+
+  all5_seek(job->dest, job->key, job->offset, job->n);
+  return NULL;
+}
+
+/**
+ * \brief ALL5 cipher, split across threads.
+ *
+ * Each thread seeks to its own slice of the stream, and generates it
+ * independently from the others.
+ *
+ * \param key a 64-bit key
+ * \param n  length of the output stream cipher
+ * \param threads number of threads to be used.
+ * \param dest the encrypted byte stream, of length n, not null-terminated.
+ *
+ * \return dest
+ */
+char* all5_parallel(char* dest, const char* key, size_t n, int threads)
+{
+  pthread_t* tids;
+  struct all5_job* jobs;
+  size_t chunk;
+  int t;
+
+  if (threads < 2) return all5(dest, key, n);
+
+  tids = malloc(threads * sizeof(pthread_t));
+  jobs = malloc(threads * sizeof(struct all5_job));
+  /* slices are a multiple of 64 outputs, but for the last one */
+  chunk = (n / threads + 63) & ~(size_t) 63;
+
+  for (t=0; t!=threads; t++) {
+    jobs[t].dest = dest + t*chunk;
+    jobs[t].key = key;
+    jobs[t].offset = t*chunk;
+    jobs[t].n = (t*chunk >= n) ? 0 : (n - t*chunk < chunk ? n - t*chunk : chunk);
+    if (pthread_create(&tids[t], NULL, all5_worker, &jobs[t])) abort();
+  }
+  for (t=0; t!=threads; t++)
+    pthread_join(tids[t], NULL);
+
+  free(jobs);
+  free(tids);
+  return dest;
+}
+
+
+/*
+ * +------------------+
+ * | Stream Interface |
+ * +------------------+
+ */
+
+/* bytes of keystream produced at once by stream_xor() */
+#define STREAM_BLOCK 4096
+
+/**
+ * \brief Sets up a stream cipher.
+ *
+ * \param cipher the generator to be used.
+ * \param key 64-byte key to be used for the cipher.
+ *
+ * \return ctx
+ */
+struct stream_ctx* stream_init(struct stream_ctx* ctx,
+                               enum stream_cipher cipher,
+                               const char* key)
+{
+  ctx->cipher = cipher;
+  switch (cipher) {
+  case STREAM_MAJ5: maj5_init(&ctx->gen.maj5, key); break;
+  case STREAM_ALL5: all5_init(&ctx->gen.all5, key); break;
+  case STREAM_A5_1: a5_1_init(&ctx->gen.a5_1, key); break;
+  default: abort();
+  }
+  return ctx;
+}
+
+/**
+ * \brief Encrypts (or decrypts) len bytes with the packed keystream.
+ *
+ * The keystream carries on from where the previous call left it, so that a
+ * message can be processed in chunks. It is produced a block at a time on the
+ * stack, and src is read front to back as dst is written: dst may be src, or
+ * start before it, but must not start inside it.
+ *
+ * \return dst
+ */
+char* stream_xor(struct stream_ctx* ctx,
+                 char* dst,
+                 const char* src,
+                 size_t len)
+{
+  unsigned char ks[STREAM_BLOCK];
+  char* start = dst;
+  size_t i, n;
+
+  for (; len; len -= n, dst += n, src += n) {
+    n = len < STREAM_BLOCK ? len : STREAM_BLOCK;
+    switch (ctx->cipher) {
+    case STREAM_MAJ5: maj5_next_bytes(&ctx->gen.maj5, ks, n); break;
+    case STREAM_ALL5: all5_next_bytes(&ctx->gen.all5, ks, n); break;
+    case STREAM_A5_1: a5_1_next_bytes(&ctx->gen.a5_1, ks, n); break;
+    }
+    for (i=0; i!=n; i++)
+      dst[i] = src[i] ^ ks[i];
+  }
+
+  return start;
+}
+
+
+/*
+ * +----------------------------+
+ * | Bitsliced Multi-Key Engine |
+ * +----------------------------+
+ */
+
+/*
+ * 64 instances of a generator run side by side, one per key: bit l of
+ * slices[j][i] holds state[i] of register j under the l-th key.
+ * A step computes all the 64 feedback bits with a single XOR per tap, and
+ * majority clocking becomes a masked shift, moving only the lanes where the
+ * register agrees with the majority.
+ */
+#define MAX_DEGREE 23
+
+typedef uint64_t slices_t[5][MAX_DEGREE];
+
+static inline uint64_t sfeedback(const uint64_t* r, uint64_t taps)
+{
+  uint64_t fb;
+
+  for (fb=0; taps; taps &= taps-1)
+    fb ^= r[__builtin_ctzll(taps)];
+  return fb;
+}
+
+/** Clocks the lanes of a register selected by mask m. */
+static inline void sclock(uint64_t* r, uint64_t taps, size_t degree, uint64_t m)
+{
+  uint64_t fb = sfeedback(r, taps);
   size_t i;
-  size_t j;
 
-  static const char* frame = "\0\0\1\0\1\1\0\0\1\0\0\0\0\0\0\0\0\0\0\0\0\0";
-  static const size_t degrees[5] = {19, 22, 23, 11, 13};
-  static const char* polys[5] = {
-    /* p = x^19 + x^18 + x^17 + x^14 + 1 */
-    "\1\0\0\0\0\0\0\0\0\0\0\0\0\0\1\0\0\1\1\1",
-    /* p = x^22 + x^21 + 1 */
-    "\1\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\1\1",
-    /* p = x^23 + x^22 + x^21 + x^8 + 1 */
-    "\1\0\0\0\0\0\0\0\1\0\0\0\0\0\0\0\0\0\0\0\0\1\1\1",
-    /* p = x^11 + x^2 + 1 */
-    "\1\0\1\0\0\0\0\0\0\0\0\1",
-    /* p = x^13 + x^4 + x^3 + x + 1 */
-    "\1\1\0\1\1\0\0\0\0\0\0\0\0\1"
-
-  };
-
-  states = key_loading(key, frame, polys, degrees, 5);
-  for (i=0; i!=100; i++) all5_update(polys, degrees, states);
-
-  for (i=0; i!=n; i++) {
-   /**
-    *  The output is computed using a semi-bent, balanced Boolean function
-    *  f: (𝔽₂)⁵ → 𝔽₂
-    *  (x₁,x₂,x₃,x₄,x₅) → x₁x₄ ⊕ x₂x₃ ⊕ x₂x₅ ⊕ x₃x₄
-    */
-   for (j=0; j!=5; j++) outputs[j] = output(states[j], degrees[j]);
-   dest[i] = outputs[0]*outputs[3] ^ outputs[1]*outputs[2] ^
-     outputs[1]*outputs[4] ^ outputs[2]*outputs[3];
-   all5_update(polys, degrees, states);
+  for (i=degree-1; i; i--)
+    r[i] ^= (r[i] ^ r[i-1]) & m;
+  r[0] ^= (r[0] ^ fb) & m;
+}
+
+/** Majority of three, per lane. */
+static inline uint64_t smaj3(uint64_t a, uint64_t b, uint64_t c)
+{
+  return (a & b) | (c & (a ^ b));
+}
+
+/** In place transposition of a 64×64 bit matrix, one row per word. */
+static void transpose64(uint64_t* a)
+{
+  uint64_t m, t;
+  int j, k;
+
+  for (j=32, m=0x00000000ffffffff; j; j >>= 1, m ^= m << j)
+    for (k=0; k < 64; k = ((k | j) + 1) & ~j) {
+      t = (a[k] >> j ^ a[k | j]) & m;
+      a[k | j] ^= t;
+      a[k] ^= t << j;
+    }
+}
+
+/**
+ * \brief Bitsliced \ref key_loading().
+ *
+ * Keys are loaded one by one through the tables, and the resulting states
+ * transposed into slices.
+ *
+ * \param keys 64 consecutive keys of 64 bytes each, one per lane.
+ */
+static void skey_loading(slices_t r, const char* keys, size_t n)
+{
+  uint64_t states[64*5];
+  uint64_t lanes[64];
+  size_t j, l;
+
+  lfsr_key_loading(states, keys, 64);
+  for (j=0; j!=n; j++) {
+    for (l=0; l!=64; l++)
+      lanes[l] = states[5*l + j];
+    transpose64(lanes);
+    memcpy(r[j], lanes, degrees[j] * sizeof(uint64_t));
+  }
+}
+
+/**
+ * \brief Runs 64 majority-clocked generators over n registers for len steps.
+ *
+ * \param dest if not NULL, bit l of dest[t] gets the t-th output of lane l.
+ */
+static inline void sclocked_run(uint64_t* dest,
+                                slices_t r,
+                                const uint64_t* taps,
+                                size_t n,
+                                size_t len)
+{
+  uint64_t c0, c1, c2, c3, c4, s, t, maj, out;
+  size_t i;
 
+  for (i=0; i!=len; i++) {
+    c0 = r[0][clocks[0]];
+    c1 = r[1][clocks[1]];
+    c2 = r[2][clocks[2]];
+    out = r[0][degrees[0]-1] ^ r[1][degrees[1]-1] ^ r[2][degrees[2]-1];
+    if (n == 3)
+      maj = smaj3(c0, c1, c2);
+    else {
+      c3 = r[3][clocks[3]];
+      c4 = r[4][clocks[4]];
+      out ^= r[3][degrees[3]-1] ^ r[4][degrees[4]-1];
+      /* at least three out of five: add up as 2t + s, with t ∈ {0, 1, 2} */
+      s = c0 ^ c1 ^ c2;
+      t = smaj3(c0, c1, c2);
+      maj = (t & smaj3(s, c3, c4)) | ((t | smaj3(s, c3, c4)) & (s ^ c3 ^ c4));
+      sclock(r[3], taps[3], degrees[3], ~(c3 ^ maj));
+      sclock(r[4], taps[4], degrees[4], ~(c4 ^ maj));
+    }
+    sclock(r[0], taps[0], degrees[0], ~(c0 ^ maj));
+    sclock(r[1], taps[1], degrees[1], ~(c1 ^ maj));
+    sclock(r[2], taps[2], degrees[2], ~(c2 ^ maj));
+    if (dest) dest[i] = out;
   }
+}
 
-  for (i=0; i!=5; i++)
-    free(states[i]);
-  free(states);
+/**
+ * \brief MAJ5 cipher under 64 keys at once.
+ *
+ * \param dest destination, of n words: bit l of dest[t] is the t-th output
+ *             bit under the l-th key.
+ * \param keys 64 consecutive keys of 64 bytes each, as taken by \ref maj5().
+ * \param n length of each output stream.
+ *
+ * \return dest
+ */
+uint64_t* maj5_x64(uint64_t* dest, const char* keys, size_t n)
+{
+  slices_t r;
+  uint64_t taps[5];
+
+  pack_polys(taps, 5);
+  skey_loading(r, keys, 5);
+  sclocked_run(NULL, r, taps, 5, 100);
+  sclocked_run(dest, r, taps, 5, n);
+
+  return dest;
+}
+
+/**
+ * \brief A5/1 cipher under 64 keys at once.
+ *
+ * Same as \ref maj5_x64(), for \ref a5_1().
+ */
+uint64_t* a5_1_x64(uint64_t* dest, const char* keys, size_t n)
+{
+  slices_t r;
+  uint64_t taps[5];
+
+  pack_polys(taps, 3);
+  skey_loading(r, keys, 3);
+  sclocked_run(NULL, r, taps, 3, 100);
+  sclocked_run(dest, r, taps, 3, n);
+
+  return dest;
+}
+
+/**
+ * \brief ALL5 cipher under 64 keys at once.
+ *
+ * Same as \ref maj5_x64(), for \ref all5(): registers are always clocked.
+ */
+uint64_t* all5_x64(uint64_t* dest, const char* keys, size_t n)
+{
+  slices_t r;
+  uint64_t taps[5];
+  uint64_t x[5];
+  size_t i, j;
+
+  pack_polys(taps, 5);
+  skey_loading(r, keys, 5);
+  for (i=0; i!=100 + n; i++) {
+    for (j=0; j!=5; j++)
+      x[j] = r[j][degrees[j]-1];
+    if (i >= 100)
+      dest[i-100] = (x[0]&x[3]) ^ (x[1]&x[2]) ^ (x[1]&x[4]) ^ (x[2]&x[3]);
+    for (j=0; j!=5; j++)
+      sclock(r[j], taps[j], degrees[j], ~(uint64_t) 0);
+  }
 
   return dest;
 }
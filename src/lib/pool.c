@@ -0,0 +1,309 @@
+/**
+ * \file pool.c
+ * \brief Pregenerated tokens and challenges.
+ *
+ * The server draws two random tokens per handshake, and encrypts one of them
+ * under the client's key as a challenge. A pool keeps up to capacity tokens,
+ * and as many challenges per registered client, generated ahead of time by
+ * background workers; handshakes pop from it, and fall back to generating
+ * inline when it has run dry.
+ *
+ * Workers refill tokens first, then the client with the fewest challenges
+ * left, and sleep once everything is full until a reservoir falls to half:
+ * refills come in batches, rather than as one wakeup per pop. The server
+ * spends most of a handshake waiting on the client, and workers use that.
+ */
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <openssl/bn.h>
+
+#include "pool.h"
+#include "rng.h"
+#include "rsa.h"
+
+struct pool_client {
+  char* name;
+  BIGNUM* e;
+  BIGNUM* n;
+  BN_MONT_CTX* mont;
+  struct mont64 m64;
+  BIGNUM** r;
+  BIGNUM** c;
+  size_t count;
+};
+
+struct pool {
+  int bits;
+  size_t capacity;
+  BIGNUM** tokens;
+  size_t ntokens;
+  struct pool_client** clients;
+  size_t nclients;
+
+  int stop;
+  pthread_mutex_t lock;
+  pthread_cond_t hungry;
+  pthread_cond_t full;
+  pthread_t* workers;
+  int nworkers;
+};
+
+
+/*
+ * +---------+
+ * | Workers |
+ * +---------+
+ */
+
+/* the client with the fewest challenges, if any has room; under the lock */
+static struct pool_client* neediest(const struct pool* p)
+{
+  struct pool_client* best = NULL;
+  size_t i;
+
+  for (i=0; i!=p->nclients; i++)
+    if (p->clients[i]->count < p->capacity &&
+        (!best || p->clients[i]->count < best->count))
+      best = p->clients[i];
+  return best;
+}
+
+static void* worker(void* arg)
+{
+  struct pool* p = arg;
+  struct pool_client* cl;
+  BIGNUM *r, *c;
+  BN_CTX* ctx = BN_CTX_new();
+
+  pthread_mutex_lock(&p->lock);
+  while (!p->stop) {
+    r = c = NULL;
+    if (p->ntokens < p->capacity) {
+      pthread_mutex_unlock(&p->lock);
+      bn_rng(&r, p->bits);
+      pthread_mutex_lock(&p->lock);
+      if (p->ntokens < p->capacity) p->tokens[p->ntokens++] = r;
+      else BN_clear_free(r);
+    } else if ((cl = neediest(p))) {
+      /* clients are never removed, nor their keys changed */
+      pthread_mutex_unlock(&p->lock);
+      bn_rng(&r, p->bits);
+      c = BN_dup(r);
+      if (!mont64_exp(c, cl->e, &cl->m64))
+        BN_mod_exp_mont(c, r, cl->e, cl->n, ctx, cl->mont);
+      pthread_mutex_lock(&p->lock);
+      if (cl->count < p->capacity) {
+        cl->r[cl->count] = r;
+        cl->c[cl->count++] = c;
+      } else {
+        BN_clear_free(r);
+        BN_free(c);
+      }
+    } else {
+      pthread_cond_broadcast(&p->full);
+      pthread_cond_wait(&p->hungry, &p->lock);
+    }
+  }
+  pthread_mutex_unlock(&p->lock);
+  BN_CTX_free(ctx);
+  return NULL;
+}
+
+
+/*
+ * +-----------+
+ * | Lifecycle |
+ * +-----------+
+ */
+
+/**
+ * \brief Starts a pool of bits-bit tokens, refilled by threads workers.
+ *
+ * \return the pool, or NULL if capacity or threads is 0.
+ */
+struct pool* pool_new(int bits, size_t capacity, int threads)
+{
+  struct pool* p;
+  int t;
+
+  if (!capacity || threads < 1) return NULL;
+  p = calloc(1, sizeof(struct pool));
+  p->bits = bits;
+  p->capacity = capacity;
+  p->tokens = malloc(capacity * sizeof(BIGNUM*));
+  pthread_mutex_init(&p->lock, NULL);
+  pthread_cond_init(&p->hungry, NULL);
+  pthread_cond_init(&p->full, NULL);
+
+  p->nworkers = threads;
+  p->workers = malloc(threads * sizeof(pthread_t));
+  for (t=0; t!=threads; t++)
+    if (pthread_create(&p->workers[t], NULL, worker, p)) abort();
+  return p;
+}
+
+/** \brief Stops the workers, and frees whatever is left. */
+void pool_free(struct pool* p)
+{
+  struct pool_client* cl;
+  size_t i, j;
+  int t;
+
+  if (!p) return;
+  pthread_mutex_lock(&p->lock);
+  p->stop = 1;
+  pthread_cond_broadcast(&p->hungry);
+  pthread_mutex_unlock(&p->lock);
+  for (t=0; t!=p->nworkers; t++)
+    pthread_join(p->workers[t], NULL);
+
+  for (i=0; i!=p->ntokens; i++)
+    BN_clear_free(p->tokens[i]);
+  for (i=0; i!=p->nclients; i++) {
+    cl = p->clients[i];
+    for (j=0; j!=cl->count; j++) {
+      BN_clear_free(cl->r[j]);
+      BN_free(cl->c[j]);
+    }
+    BN_free(cl->e);
+    BN_free(cl->n);
+    BN_MONT_CTX_free(cl->mont);
+    free(cl->r);
+    free(cl->c);
+    free(cl->name);
+    free(cl);
+  }
+  pthread_cond_destroy(&p->hungry);
+  pthread_cond_destroy(&p->full);
+  pthread_mutex_destroy(&p->lock);
+  free(p->clients);
+  free(p->tokens);
+  free(p->workers);
+  free(p);
+}
+
+/**
+ * \brief Registers a client, whose challenges will be pregenerated.
+ *
+ * \return 1 if added, 0 if the pool is NULL.
+ */
+int pool_add_client(struct pool* p, const char* name,
+                    const BIGNUM* e, const BIGNUM* n)
+{
+  struct pool_client* cl;
+  BN_CTX* ctx;
+
+  if (!p) return 0;
+  cl = malloc(sizeof(struct pool_client));
+  cl->name = strdup(name);
+  cl->e = BN_dup(e);
+  cl->n = BN_dup(n);
+  /* read-only once set, so the workers share it */
+  ctx = BN_CTX_new();
+  cl->mont = BN_MONT_CTX_new();
+  BN_MONT_CTX_set(cl->mont, n, ctx);
+  BN_CTX_free(ctx);
+  mont64_set(&cl->m64, n);
+  cl->r = malloc(p->capacity * sizeof(BIGNUM*));
+  cl->c = malloc(p->capacity * sizeof(BIGNUM*));
+  cl->count = 0;
+
+  pthread_mutex_lock(&p->lock);
+  p->clients = realloc(p->clients, (p->nclients + 1) * sizeof(struct pool_client*));
+  p->clients[p->nclients++] = cl;
+  pthread_cond_broadcast(&p->hungry);
+  pthread_mutex_unlock(&p->lock);
+  return 1;
+}
+
+/** \brief Blocks until the pool is full, e.g. to warm up before serving. */
+void pool_wait(struct pool* p)
+{
+  if (!p) return;
+  pthread_mutex_lock(&p->lock);
+  /* workers may be asleep above the watermark: have them top up */
+  pthread_cond_broadcast(&p->hungry);
+  while (p->ntokens < p->capacity || neediest(p))
+    pthread_cond_wait(&p->full, &p->lock);
+  pthread_mutex_unlock(&p->lock);
+}
+
+
+/*
+ * +---------+
+ * | Popping |
+ * +---------+
+ */
+
+/**
+ * \brief A random token, as from \ref bn_rng(): pregenerated if any is left.
+ *
+ * \param[in][out] dest If NULL, a new BIGNUM* is assigned to it.
+ * \param          bits as for \ref bn_rng(); the pool serves its own size only.
+ * \return *dest
+ */
+BIGNUM* pool_token(struct pool* p, BIGNUM** dest, int bits)
+{
+  BIGNUM* t = NULL;
+
+  if (p && p->bits == bits) {
+    pthread_mutex_lock(&p->lock);
+    if (p->ntokens) {
+      t = p->tokens[--p->ntokens];
+      if (p->ntokens == p->capacity / 2) pthread_cond_broadcast(&p->hungry);
+    }
+    pthread_mutex_unlock(&p->lock);
+  }
+  if (!t) return bn_rng(dest, bits);
+
+  if (!*dest) *dest = BN_new();
+  BN_copy(*dest, t);
+  BN_clear_free(t);
+  return *dest;
+}
+
+/**
+ * \brief A challenge for client name: a bits-bit token r, and c = r^e mod n.
+ *
+ * Pregenerated if the client is registered under the same key and has any
+ * left, otherwise generated inline.
+ *
+ * \return 1 if it came from the pool, 0 if not.
+ */
+int pool_challenge(struct pool* p, const char* name, int bits,
+                   const BIGNUM* e, const BIGNUM* n, BIGNUM** r, BIGNUM** c)
+{
+  struct pool_client* cl = NULL;
+  BIGNUM *pr = NULL, *pc = NULL;
+  size_t i;
+
+  if (p && p->bits == bits) {
+    pthread_mutex_lock(&p->lock);
+    for (i=0; i!=p->nclients && !cl; i++)
+      if (!strcmp(p->clients[i]->name, name) &&
+          !BN_cmp(p->clients[i]->e, e) && !BN_cmp(p->clients[i]->n, n))
+        cl = p->clients[i];
+    if (cl && cl->count) {
+      pr = cl->r[--cl->count];
+      pc = cl->c[cl->count];
+      if (cl->count == p->capacity / 2) pthread_cond_broadcast(&p->hungry);
+    }
+    pthread_mutex_unlock(&p->lock);
+  }
+
+  if (!*c) *c = BN_new();
+  if (!pr) {
+    pool_token(p, r, bits);
+    BN_copy(*c, *r);
+    rsa_encrypt(*c, e, n);
+    return 0;
+  }
+  if (!*r) *r = BN_new();
+  BN_copy(*r, pr);
+  BN_copy(*c, pc);
+  BN_clear_free(pr);
+  BN_free(pc);
+  return 1;
+}
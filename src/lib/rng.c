@@ -11,21 +11,22 @@
  *
  *
  */
+#include <assert.h>
+#include <endian.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/random.h>
 
 #include <openssl/bn.h>
 
+#include "bm.h"
 #include "lfsr.h"
 #include "bunny24.h"
 #include "rng.h"
-
-/**
- * Now, here we know that the seed should be cryptographically secure.
- * But that would take a shit load of time.
- */
-#define RANDOM_DEVICE "/dev/urandom"
-//#define RANDOM_DEVICE "/dev/random"
+#include "vectorize.h"
 
 /*
  * +------------------+
@@ -33,46 +34,333 @@
  * +------------------+
  */
 
-static int MT[624];
-static int frng_index = 0;
+/*
+ * MT19937, as in Matsumoto and Nishimura's reference implementation.
+ * Each context is a generator on its own: threads and sessions seed their own
+ * once, and draw from it as long as they need.
+ */
+#define MT_M 397
+#define MT_MATRIX 0x9908b0df
+#define MT_UPPER 0x80000000
+#define MT_LOWER 0x7fffffff
 
-static void init_generator(int seed)
+/**
+ * \brief Seeds a Mersenne Twister.
+ *
+ * \return ctx
+ */
+struct mt_ctx* mt_init(struct mt_ctx* ctx, uint32_t seed)
 {
   size_t i;
 
-  frng_index = 0;
-  MT[0] = seed;
-  for (i=1; i!=624; i++)
-    MT[i] = 0xffff & (0x6c078965 * (MT[i-1] ^ ((MT[i-1] >> 30) + i)));
+  ctx->state[0] = seed;
+  for (i=1; i!=MT_N; i++)
+    ctx->state[i] = 1812433253 * (ctx->state[i-1] ^ (ctx->state[i-1] >> 30)) + i;
+  ctx->index = MT_N;
 
+  return ctx;
 }
 
-static void generate_untampered(void)
+/**
+ * \brief Next MT_N untempered words, all at once.
+ *
+ * Word i depends on words i+1 and i+M of the previous state, or on the new
+ * word i+M-N, hence the two loops carry no dependency shorter than N-M = 227
+ * words, and run eight words at a time with AVX2.
+ */
+VECTORIZE
+static void twist(uint32_t* mt)
 {
+  uint32_t y;
   size_t i;
-  int y;
 
-  for (i=0; i!=624; i++) {
-    y = (MT[i] ^ 0x80000000) + (MT[(i+1) % 624] & 0x7fffffff);
-    MT[i] = MT[(i + 397) % 624] ^ (y >> 1);
-    if (y % 2) MT[i] ^= 0x9908b0df;
+  for (i=0; i!=MT_N - MT_M; i++) {
+    y = (mt[i] & MT_UPPER) | (mt[i+1] & MT_LOWER);
+    mt[i] = mt[i + MT_M] ^ (y >> 1) ^ (-(y & 1) & MT_MATRIX);
+  }
+  for (; i!=MT_N - 1; i++) {
+    y = (mt[i] & MT_UPPER) | (mt[i+1] & MT_LOWER);
+    mt[i] = mt[i + MT_M - MT_N] ^ (y >> 1) ^ (-(y & 1) & MT_MATRIX);
   }
+  y = (mt[MT_N-1] & MT_UPPER) | (mt[0] & MT_LOWER);
+  mt[MT_N-1] = mt[MT_M-1] ^ (y >> 1) ^ (-(y & 1) & MT_MATRIX);
 }
 
-static int extract_number(void) {
-  int y;
-
-  if (frng_index == 0) generate_untampered();
-  y = MT[frng_index];
-  y ^= (y >> 11);
+static inline uint32_t temper(uint32_t y)
+{
+  y ^= y >> 11;
   y ^= (y << 7) & 0x9d2c5680;
   y ^= (y << 15) & 0xefc60000;
-  y ^= (y >> 18);
+  y ^= y >> 18;
+  return y;
+}
+
+VECTORIZE
+static void temper_block(uint32_t* restrict dest, const uint32_t* restrict src, size_t n)
+{
+  size_t i;
+
+  for (i=0; i!=n; i++)
+    dest[i] = temper(src[i]);
+}
+
+/**
+ * \brief Next 32-bit output of a Mersenne Twister.
+ */
+uint32_t mt_next(struct mt_ctx* ctx)
+{
+  if (ctx->index == MT_N) {
+    twist(ctx->state);
+    ctx->index = 0;
+  }
+  return temper(ctx->state[ctx->index++]);
+}
+
+/**
+ * \brief Next n 32-bit outputs of a Mersenne Twister.
+ *
+ * Same as n calls to \ref mt_next(), twisting and tempering a whole state
+ * at a time.
+ *
+ * \return dest
+ */
+uint32_t* mt_fill32(struct mt_ctx* ctx, uint32_t* dest, size_t n)
+{
+  size_t done, step;
+
+  for (done=0; done != n; done += step) {
+    if (ctx->index == MT_N) {
+      twist(ctx->state);
+      ctx->index = 0;
+    }
+    step = MT_N - ctx->index < n - done ? MT_N - ctx->index : n - done;
+    temper_block(dest + done, ctx->state + ctx->index, step);
+    ctx->index += step;
+  }
+
+  return dest;
+}
+
+/**
+ * \brief Next len bytes from a Mersenne Twister.
+ *
+ * Each output gives four bytes, least significant first; a final partial
+ * word is used for the last len % 4 bytes, and the rest of it dropped.
+ *
+ * \return dest
+ */
+unsigned char* mt_fill(struct mt_ctx* ctx, unsigned char* dest, size_t len)
+{
+  uint32_t buf[MT_N];
+  size_t i, n, words;
+
+  for (n=0; n != len; n += words) {
+    words = (len - n + 3) / 4 < MT_N ? (len - n + 3) / 4 : MT_N;
+    mt_fill32(ctx, buf, words);
+    for (i=0; i!=words; i++)
+      buf[i] = htole32(buf[i]);
+    words = 4*words < len - n ? 4*words : len - n;
+    memcpy(dest + n, buf, words);
+  }
+
+  return dest;
+}
+
+
+/*
+ * +------------------------+
+ * | Mersenne Twister Jumps |
+ * +------------------------+
+ */
+
+/*
+ * Past the seeding, the window x_t, …, x_(t+N-1) of untempered words evolves
+ * by a linear map T with minimal polynomial φ, of degree 19937. Hence moving J
+ * outputs ahead is applying T^J = g(T), with g = x^J mod φ: the sum of the
+ * windows t + i, 0 ≤ i < 19937, for which gᵢ = 1.
+ *
+ * φ is found once, by Berlekamp–Massey on an output bit; the jump polynomials
+ * for 2^k outputs are cached, each computed from the previous one by
+ * squaring.
+ */
+#define MT_DEGREE 19937
+#define MT_WORDS (MT_DEGREE/64 + 1)
+#define MT_JUMP_MAX 1024
+
+/* φ·x^s, for 0 ≤ s < 64 */
+static uint64_t shifted_phi[64][MT_WORDS + 1];
+static pthread_once_t phi_once = PTHREAD_ONCE_INIT;
+static uint64_t* jump_polys[MT_JUMP_MAX];
+static pthread_mutex_t jump_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void phi_init(void)
+{
+  struct mt_ctx ctx;
+  uint64_t* bits;
+  uint64_t* c;
+  size_t i, L;
+  unsigned s;
+
+  bits = calloc(2*MT_DEGREE/64 + 1, sizeof(uint64_t));
+  c = calloc(2*MT_DEGREE/64 + 1, sizeof(uint64_t));
+  assert(bits && c);
+  mt_init(&ctx, 5489);
+  for (i=0; i!=2*MT_DEGREE; i++)
+    bits[i/64] |= (uint64_t) (mt_next(&ctx) & 1) << (i%64);
+  L = connection_polynomial(bits, 2*MT_DEGREE, c);
+  assert(L == MT_DEGREE);
+
+  /* φ(x) = x^L·C(1/x) */
+  for (i=0; i<=MT_DEGREE; i++)
+    if (c[(MT_DEGREE-i)/64] >> ((MT_DEGREE-i)%64) & 1)
+      shifted_phi[0][i/64] |= (uint64_t) 1 << (i%64);
+  for (s=1; s!=64; s++)
+    for (i=0; i!=MT_WORDS + 1; i++)
+      shifted_phi[s][i] = shifted_phi[0][i] << s |
+        (i ? shifted_phi[0][i-1] >> (64 - s) : 0);
+
+  free(bits);
+  free(c);
+}
 
-  frng_index = (frng_index+1) % 624;
+/** Spreads the 32 bits of x to the even positions of a word. */
+static inline uint64_t spread(uint32_t x)
+{
+  uint64_t y = x;
+
+  y = (y | y << 16) & 0x0000ffff0000ffff;
+  y = (y | y << 8) & 0x00ff00ff00ff00ff;
+  y = (y | y << 4) & 0x0f0f0f0f0f0f0f0f;
+  y = (y | y << 2) & 0x3333333333333333;
+  y = (y | y << 1) & 0x5555555555555555;
   return y;
 }
 
+/** dest = a² mod φ: squaring over 𝔽₂ just spreads the coefficients. */
+static void sqrmod(uint64_t* dest, const uint64_t* a)
+{
+  uint64_t sq[2*MT_WORDS];
+  size_t i, d, q, j;
+
+  for (i=0; i!=MT_WORDS; i++) {
+    sq[2*i] = spread(a[i]);
+    sq[2*i+1] = spread(a[i] >> 32);
+  }
+  for (d=2*MT_DEGREE - 2; d >= MT_DEGREE; d--)
+    if (sq[d/64] >> (d%64) & 1) {
+      q = (d - MT_DEGREE) / 64;
+      for (j=0; j!=MT_WORDS + 1; j++)
+        sq[q+j] ^= shifted_phi[(d - MT_DEGREE) % 64][j];
+    }
+  memcpy(dest, sq, MT_WORDS * sizeof(uint64_t));
+}
+
+/** x^(2^k) mod φ. */
+static const uint64_t* jump_poly(unsigned k)
+{
+  unsigned i;
+
+  assert(k < MT_JUMP_MAX);
+  pthread_once(&phi_once, phi_init);
+  pthread_mutex_lock(&jump_lock);
+  if (!jump_polys[0]) {
+    jump_polys[0] = calloc(MT_WORDS, sizeof(uint64_t));
+    jump_polys[0][0] = 2;
+  }
+  for (i=k; !jump_polys[i]; i--) ;
+  for (; i!=k; i++) {
+    jump_polys[i+1] = malloc(MT_WORDS * sizeof(uint64_t));
+    sqrmod(jump_polys[i+1], jump_polys[i]);
+  }
+  pthread_mutex_unlock(&jump_lock);
+
+  return jump_polys[k];
+}
+
+/** The window of untempered words starting at the next output. */
+static void mt_window(uint32_t* w, const struct mt_ctx* ctx)
+{
+  uint32_t next[MT_N];
+
+  memcpy(next, ctx->state, sizeof(next));
+  if (ctx->index) twist(next);
+  memcpy(w, ctx->state + ctx->index, (MT_N - ctx->index) * sizeof(uint32_t));
+  memcpy(w + MT_N - ctx->index, next, ctx->index * sizeof(uint32_t));
+}
+
+/**
+ * \brief w = g(T)·w: the sum of the windows from w on for which gᵢ = 1.
+ *
+ * Successive windows are kept in a circular buffer, one word at a time.
+ */
+VECTORIZE
+static void apply_poly(uint32_t* w, const uint64_t* g)
+{
+  uint32_t acc[MT_N], buf[MT_N];
+  uint32_t y;
+  size_t i, j, p;
+
+  memset(acc, 0, sizeof(acc));
+  memcpy(buf, w, sizeof(buf));
+  for (i=p=0; i!=MT_DEGREE; i++) {
+    if (g[i/64] >> (i%64) & 1) {
+      for (j=0; j!=MT_N - p; j++)
+        acc[j] ^= buf[p + j];
+      for (j=0; j!=p; j++)
+        acc[MT_N - p + j] ^= buf[j];
+    }
+    y = (buf[p] & MT_UPPER) | (buf[p+1 == MT_N ? 0 : p+1] & MT_LOWER);
+    buf[p] = buf[p + MT_M < MT_N ? p + MT_M : p + MT_M - MT_N] ^
+      (y >> 1) ^ (-(y & 1) & MT_MATRIX);
+    p = p+1 == MT_N ? 0 : p+1;
+  }
+  memcpy(w, acc, sizeof(acc));
+}
+
+/**
+ * \brief Moves a Mersenne Twister 2^k outputs ahead.
+ *
+ * Takes a few milliseconds, once the jump polynomial is known: the first
+ * jump by 2^k computes it, in about k milliseconds more.
+ *
+ * \param k less than 1024.
+ *
+ * \return ctx
+ */
+struct mt_ctx* mt_jump(struct mt_ctx* ctx, unsigned k)
+{
+  uint32_t w[MT_N];
+
+  mt_window(w, ctx);
+  apply_poly(w, jump_poly(k));
+  memcpy(ctx->state, w, sizeof(w));
+  ctx->index = 0;
+
+  return ctx;
+}
+
+/**
+ * \brief Disjoint substreams from a single seed.
+ *
+ * ctxs[i] starts i·2^k outputs into the stream of seed: each of n workers
+ * may draw up to 2^k outputs without overlapping the next one.
+ *
+ * \return ctxs
+ */
+struct mt_ctx* mt_substreams(struct mt_ctx* ctxs, size_t n, uint32_t seed, unsigned k)
+{
+  size_t i;
+
+  if (!n) return ctxs;
+  mt_init(&ctxs[0], seed);
+  for (i=1; i!=n; i++) {
+    ctxs[i] = ctxs[i-1];
+    mt_jump(&ctxs[i], k);
+  }
+
+  return ctxs;
+}
+
 
 /**
  * \brief Fast Random Number Generator.
@@ -80,6 +368,9 @@ static int extract_number(void) {
  * Generates a random sequence of integers satisfying:
  *  - "good" statistical properties.
  *
+ * A wrapper around \ref mt_fill() for one-shot callers: those drawing many
+ * times shall keep a struct mt_ctx instead of reseeding at each call.
+ *
  * \note it is not requested that from the output bits the state can be recovered.
  *
  * \param      seed the seeed to initialize the pseudorandom numer generation.
@@ -91,13 +382,203 @@ static int extract_number(void) {
  */
 char* frng(char* dest, const char* seed, const size_t len)
 {
+  struct mt_ctx ctx;
+  uint32_t iseed;
+
+  memcpy(&iseed, seed, sizeof(iseed));
+  mt_fill(mt_init(&ctx, iseed), (unsigned char*) dest, len);
+
+  return dest;
+}
+
+
+/*
+ * +---------+
+ * | Entropy |
+ * +---------+
+ */
+
+/*
+ * Seeds come from the kernel through getrandom(), which needs no file
+ * descriptor and blocks only until the pool is first initialized. Each thread
+ * keeps a buffer of its own, refilled a page at a time, so that the many small
+ * draws of a handshake cost a memcpy rather than a system call; bytes are
+ * wiped as they are handed out.
+ */
+#define ENTROPY_POOL 4096
+
+static __thread unsigned char pool[ENTROPY_POOL];
+static __thread size_t pool_left;
+static pthread_once_t pool_once = PTHREAD_ONCE_INIT;
+
+/* a child shall not hand out the bytes its parent is going to */
+static void pool_forget(void)
+{
+  explicit_bzero(pool, sizeof(pool));
+  pool_left = 0;
+}
+
+static void pool_atfork(void)
+{
+  pthread_atfork(NULL, NULL, pool_forget);
+}
+
+/** Fills dest straight from the kernel. */
+static void getrandom_all(unsigned char* dest, size_t len)
+{
+  ssize_t got;
+
+  while (len) {
+    got = getrandom(dest, len, 0);
+    if (got < 0) {
+      assert(errno == EINTR);
+      continue;
+    }
+    dest += got;
+    len -= got;
+  }
+}
+
+/**
+ * \brief Kernel entropy, through a per-thread pool.
+ *
+ * Requests as large as the pool bypass it.
+ *
+ * \param[out] dest destination for len random bytes.
+ * \return     \ref dest
+ */
+void* entropy(void* dest, size_t len)
+{
+  unsigned char* out = dest;
+  size_t n;
+
+  pthread_once(&pool_once, pool_atfork);
+  if (len >= ENTROPY_POOL) {
+    getrandom_all(out, len);
+    return dest;
+  }
+  while (len) {
+    if (!pool_left) {
+      getrandom_all(pool, ENTROPY_POOL);
+      pool_left = ENTROPY_POOL;
+    }
+    n = len < pool_left ? len : pool_left;
+    /* hand out from the end, so that what is left stays in front */
+    pool_left -= n;
+    memcpy(out, pool + pool_left, n);
+    explicit_bzero(pool + pool_left, n);
+    out += n;
+    len -= n;
+  }
+  return dest;
+}
+
+
+/*
+ * +------------------+
+ * | Bunny24-CTR DRBG |
+ * +------------------+
+ */
+
+/*
+ * bunny24 in counter mode, a buffer of keystream at a time, with fast key
+ * erasure: the first block of each buffer is the next key, and is wiped with
+ * every byte handed out, so that the state left behind tells nothing of the
+ * output already drawn. Contexts seeded from entropy() fold fresh bytes into
+ * the next key every DRBG_RESEED bytes; those seeded by hand repeat. With
+ * 24-bit keys, a chain of keys closes into a cycle after some 2^12 buffers:
+ * reseeding is what keeps long streams from doing the same.
+ */
+#define DRBG_RESEED (1 << 20)
+
+static void drbg_refill(struct drbg_ctx* ctx)
+{
+  uint32_t blocks[DRBG_BLOCKS];
+  unsigned char fresh[4];
+  char next[3];
   size_t i;
-  int iseed = *((int *) seed);
 
-  init_generator(iseed);
-  for (i=0; i!=len; i++)
-    dest[i] = extract_number();
+  bunny24_ctr_blocks(&ctx->key, blocks, ctx->nonce << 16, DRBG_BLOCKS);
+  for (i=0; i!=DRBG_BLOCKS; i++) {
+    ctx->buf[3*i] = blocks[i] >> 16;
+    ctx->buf[3*i + 1] = blocks[i] >> 8;
+    ctx->buf[3*i + 2] = blocks[i];
+  }
+  memcpy(next, ctx->buf, 3);
+  if (ctx->reseeds && ctx->since_reseed >= DRBG_RESEED) {
+    entropy(fresh, sizeof(fresh));
+    for (i=0; i!=3; i++)
+      next[i] ^= fresh[i];
+    ctx->nonce = fresh[3];
+    ctx->since_reseed = 0;
+    explicit_bzero(fresh, sizeof(fresh));
+  }
+  bunny24_setkey(&ctx->key, next);
+
+  explicit_bzero(next, sizeof(next));
+  explicit_bzero(blocks, sizeof(blocks));
+  explicit_bzero(ctx->buf, 3);
+  ctx->left = sizeof(ctx->buf) - 3;
+}
+
+/**
+ * \brief Seeds a DRBG by hand.
+ *
+ * The first three bytes of seed are the key, the fourth picks the counter
+ * range. The same seed gives the same stream, which never reseeds.
+ *
+ * \return ctx
+ */
+struct drbg_ctx* drbg_seed(struct drbg_ctx* ctx, const char* seed)
+{
+  bunny24_setkey(&ctx->key, seed);
+  ctx->nonce = (unsigned char) seed[3];
+  ctx->reseeds = 0;
+  ctx->since_reseed = 0;
+  drbg_refill(ctx);
+
+  return ctx;
+}
+
+/**
+ * \brief Seeds a DRBG from \ref entropy(), and reseeds it as it goes.
+ *
+ * \return ctx
+ */
+struct drbg_ctx* drbg_init(struct drbg_ctx* ctx)
+{
+  char seed[4];
+
+  drbg_seed(ctx, entropy(seed, sizeof(seed)));
+  ctx->reseeds = 1;
+  explicit_bzero(seed, sizeof(seed));
+
+  return ctx;
+}
+
+/**
+ * \brief Draws len bytes, of any length.
+ *
+ * \param[out] dest destination of len bytes.
+ * \return     \ref dest
+ */
+void* drbg_generate(struct drbg_ctx* ctx, void* dest, size_t len)
+{
+  unsigned char* out = dest;
+  unsigned char* from;
+  size_t n;
 
+  while (len) {
+    if (!ctx->left) drbg_refill(ctx);
+    n = len < ctx->left ? len : ctx->left;
+    from = ctx->buf + sizeof(ctx->buf) - ctx->left;
+    memcpy(out, from, n);
+    explicit_bzero(from, n);
+    ctx->left -= n;
+    ctx->since_reseed += n;
+    out += n;
+    len -= n;
+  }
   return dest;
 }
 
@@ -110,7 +591,8 @@ char* frng(char* dest, const char* seed, const size_t len)
  *  - security constraint;
  *  - from the output bits the initial state cannot be recovered.
  *
- * \note dest shall be capable of holding len/3*3 + 3*(len%3!=0)
+ * A wrapper around \ref drbg_generate() for one-shot callers: len may be any
+ * length.
  *
  * \param      seed the seed used to initialize the pseudorandom number generation.
  * \param      len length of the output to be produced.
@@ -120,16 +602,10 @@ char* frng(char* dest, const char* seed, const size_t len)
  */
 char* srng(char* dest, const char* seed, size_t len)
 {
-  char iv[3] = {0};
+  struct drbg_ctx ctx;
 
-  /*
-   * Assuming that the seed given consists of 4bytes truly random,
-   * we distribute the first three as key to the bunny24 algorithm,
-   * and the last one as iv.
-   */
-  iv[0] = seed[3];
-  bzero(dest, len * sizeof(char));
-  bunny24_cbc_encrypt(dest, iv, seed, dest, len);
+  drbg_generate(drbg_seed(&ctx, seed), dest, len);
+  explicit_bzero(&ctx, sizeof(ctx));
 
   return dest;
 }
@@ -140,7 +616,8 @@ char* srng(char* dest, const char* seed, size_t len)
  * \brief Bignum random number generator.
  *
  * Using the secure RNG in order to generate a stream of bytes used to represent
- * a BIGNUM.
+ * a BIGNUM, straight from \ref entropy(): the DRBG would make every token a
+ * thread hands out follow from a 32-bit state, which one of them gives away.
  * The bignum is *surely* different from 0 and 1.
  *
  * \param[in][out] p If NULL, a new BIGNUM* is assigned to it.
@@ -148,10 +625,7 @@ char* srng(char* dest, const char* seed, size_t len)
  */
 BIGNUM* bn_rng(BIGNUM **p, int bits)
 {
-  int i = 0;
   int bytes_units;
-  char seed[4];
-  FILE *fp = fopen(RANDOM_DEVICE, "r");
   unsigned char *buf;
 
   if (!*p) *p = BN_new();
@@ -161,26 +635,264 @@ BIGNUM* bn_rng(BIGNUM **p, int bits)
   buf = malloc(bytes_units * sizeof(char));
 
   do {
-    for (i=0; i!=4; i++) seed[i] = fgetc(fp);
-    srng((char *) buf, seed, bytes_units);
+    entropy(buf, bytes_units);
     BN_bin2bn(buf, bytes_units, *p);
   } while (BN_is_zero(*p) || BN_is_one(*p));
 
-  fclose(fp);
+  explicit_bzero(buf, bytes_units);
   free(buf);
   return *p;
 }
 
+/*
+ * +--------------+
+ * | Prime Search |
+ * +--------------+
+ */
+
+/*
+ * Candidates are the odd numbers start, start+2, … after a single random
+ * start, taken SIEVE_WINDOW at a time. Each window is sieved by the odd
+ * primes below SIEVE_BOUND, from the residues of start, and only the survivors
+ * go through Miller–Rabin: about one candidate in 9.
+ */
+#define SIEVE_BOUND (1 << 15)
+#define SIEVE_WINDOW 4096
+
+static uint16_t small_primes[SIEVE_BOUND / 2];
+static size_t small_primes_count;
+static pthread_once_t small_primes_once = PTHREAD_ONCE_INIT;
+
+static void small_primes_init(void)
+{
+  static unsigned char composite[SIEVE_BOUND];
+  size_t i, j;
+
+  for (i=3; i<SIEVE_BOUND; i+=2) {
+    if (composite[i]) continue;
+    small_primes[small_primes_count++] = i;
+    for (j=i*i; j<SIEVE_BOUND; j+=2*i)
+      composite[j] = 1;
+  }
+}
+
+/*
+ * Marks in composite[j] the start + (j << shift), 0 ≤ j < SIEVE_WINDOW,
+ * divisible by one of the first n small primes, given residues[i] = start
+ * mod pᵢ. If safe is set, also those c for which (c-1)/2 is.
+ */
+static void sieve_window(unsigned char* composite, const uint32_t* residues, size_t n,
+                         unsigned shift, int safe)
+{
+  uint32_t p, inv, j;
+  size_t i;
+
+  memset(composite, 0, SIEVE_WINDOW);
+  for (i=0; i!=n; i++) {
+    p = small_primes[i];
+    /* 1/2^shift (mod p) */
+    inv = (p + 1) / 2;
+    if (shift == 2) inv = (uint64_t) inv * inv % p;
+    /* start + (j << shift) ≡ 0, that is j ≡ -start/2^shift (mod p) */
+    j = (uint64_t) (p - residues[i]) % p * inv % p;
+    for (; j < SIEVE_WINDOW; j += p)
+      composite[j] = 1;
+    if (!safe) continue;
+    /* ≡ 1 */
+    j = (uint64_t) (p + 1 - residues[i]) % p * inv % p;
+    for (; j < SIEVE_WINDOW; j += p)
+      composite[j] = 1;
+  }
+}
+
+/*
+ * How many small primes to sieve a search from start with: a small start may
+ * be one of them, or twice one of them plus one, itself.
+ */
+static size_t sieve_primes(const BIGNUM* start)
+{
+  size_t n;
+
+  pthread_once(&small_primes_once, small_primes_init);
+  for (n=small_primes_count; BN_num_bits(start) <= 17 && n &&
+         2*small_primes[n-1] + 1 >= BN_get_word(start); n--) ;
+  return n;
+}
+
 /**
  * \brief A "safe" prime random number generator. *
  *
+ * Searches upwards from a random odd \ref bn_rng(), sieving before testing.
  */
 BIGNUM* prng(BIGNUM** p, int bits)
 {
-  do {
-    bn_rng(p, bits);
-    if (!BN_is_odd(*p)) BN_add(*p, *p, BN_value_one());
-  } while (!BN_is_prime(*p, 10, NULL, NULL, NULL));
+  uint32_t residues[SIEVE_BOUND / 2];
+  unsigned char composite[SIEVE_WINDOW];
+  BN_CTX* ctx = BN_CTX_new();
+  size_t i, n, j;
+
+  bn_rng(p, bits);
+  if (!BN_is_odd(*p)) BN_add_word(*p, 1);
+
+  n = sieve_primes(*p);
+  for (i=0; i!=n; i++)
+    residues[i] = BN_mod_word(*p, small_primes[i]);
+
+  while (1) {
+    sieve_window(composite, residues, n, 1, 0);
+    for (j=0; j!=SIEVE_WINDOW; j++) {
+      if (composite[j]) continue;
+      BN_add_word(*p, 2*j);
+      if (BN_is_prime_ex(*p, 10, ctx, NULL)) goto found;
+      BN_sub_word(*p, 2*j);
+    }
+    BN_add_word(*p, 2*SIEVE_WINDOW);
+    for (i=0; i!=n; i++)
+      residues[i] = (residues[i] + 2*SIEVE_WINDOW) % small_primes[i];
+  }
+
+found:
+  BN_CTX_free(ctx);
+  return *p;
+}
+
+
+/*
+ * +-------------+
+ * | Safe Primes |
+ * +-------------+
+ */
+
+/*
+ * A safe prime p = 2q + 1 has q odd, hence p ≡ 3 (mod 4): candidates go 4 by
+ * 4, and the sieve drops those where either p or q has a small factor, which
+ * leaves about one in 130. Survivors go through a base-2 Fermat test on q and
+ * then on p before the full test, which OpenSSL runs with at least 64 rounds
+ * on primes: most q that pass give a composite p. Workers race from random
+ * starts of their own, starting afresh whenever a search runs past bits; the
+ * first one to find a safe prime raises the flag the others check between
+ * candidates.
+ */
+struct safe_search {
+  int bits;
+  int found;
+  BIGNUM* p;
+  pthread_mutex_t lock;
+};
+
+/** 2^(n-1) ≡ 1 (mod n) */
+static int fermat(const BIGNUM* n, BN_CTX* ctx)
+{
+  BIGNUM *e, *r;
+  int ok;
+
+  BN_CTX_start(ctx);
+  e = BN_CTX_get(ctx);
+  r = BN_CTX_get(ctx);
+  ok = r && BN_sub(e, n, BN_value_one()) &&
+    BN_mod_exp_mont_word(r, 2, e, n, ctx, NULL) && BN_is_one(r);
+  BN_CTX_end(ctx);
+  return ok;
+}
+
+static int is_safe_prime(const BIGNUM* p, BIGNUM* q, BN_CTX* ctx)
+{
+  BN_rshift1(q, p);
+  return fermat(q, ctx) && fermat(p, ctx) &&
+    BN_is_prime_ex(q, 10, ctx, NULL) && BN_is_prime_ex(p, 10, ctx, NULL);
+}
+
+/* a random start of bits bits, the top two set, p ≡ 3 (mod 4); the sieve size */
+static size_t safe_start(BIGNUM** p, uint32_t* residues, int bits)
+{
+  size_t i, n;
+
+  bn_rng(p, bits);
+  BN_mask_bits(*p, bits);
+  BN_set_bit(*p, bits - 1);
+  BN_set_bit(*p, bits - 2);
+  BN_add_word(*p, 3 - BN_mod_word(*p, 4));
+  n = sieve_primes(*p);
+  for (i=0; i!=n; i++)
+    residues[i] = BN_mod_word(*p, small_primes[i]);
+  return n;
+}
+
+static void* safe_worker(void* arg)
+{
+  struct safe_search* s = arg;
+  uint32_t residues[SIEVE_BOUND / 2];
+  unsigned char composite[SIEVE_WINDOW];
+  BN_CTX* ctx = BN_CTX_new();
+  BIGNUM *p = NULL, *q = BN_new();
+  size_t i, n, j;
+
+  n = safe_start(&p, residues, s->bits);
+  while (!__atomic_load_n(&s->found, __ATOMIC_RELAXED)) {
+    sieve_window(composite, residues, n, 2, 1);
+    for (j=0; j!=SIEVE_WINDOW; j++) {
+      if (composite[j]) continue;
+      if (__atomic_load_n(&s->found, __ATOMIC_RELAXED)) goto out;
+      BN_add_word(p, 4*j);
+      if (BN_num_bits(p) > s->bits) break;
+      if (is_safe_prime(p, q, ctx)) {
+        pthread_mutex_lock(&s->lock);
+        if (!s->found) BN_copy(s->p, p);
+        __atomic_store_n(&s->found, 1, __ATOMIC_RELAXED);
+        pthread_mutex_unlock(&s->lock);
+        goto out;
+      }
+      BN_sub_word(p, 4*j);
+    }
+    if (j != SIEVE_WINDOW) {
+      /* past 2^bits */
+      n = safe_start(&p, residues, s->bits);
+      continue;
+    }
+    BN_add_word(p, 4*SIEVE_WINDOW);
+    for (i=0; i!=n; i++)
+      residues[i] = (residues[i] + 4*SIEVE_WINDOW) % small_primes[i];
+  }
+
+out:
+  BN_free(p);
+  BN_free(q);
+  BN_CTX_free(ctx);
+  return NULL;
+}
+
+/**
+ * \brief Safe prime generator: p and (p-1)/2 both prime.
+ *
+ * The top two of the bits are set, so that the product of two such primes
+ * has 2·bits exactly.
+ *
+ * \param[in][out] p       If NULL, a new BIGNUM* is assigned to it.
+ * \param          bits    the size of p: 3, or at least 6, as no safe prime
+ *                         of 4 or 5 bits has its top two set.
+ * \param          threads workers searching at once; at least one runs.
+ * \return p
+ */
+BIGNUM* safe_prng(BIGNUM** p, int bits, int threads)
+{
+  struct safe_search s;
+  pthread_t* tids;
+  int t;
+
+  if (!*p) *p = BN_new();
+  if (threads < 1) threads = 1;
+  s.bits = bits;
+  s.found = 0;
+  s.p = *p;
+  pthread_mutex_init(&s.lock, NULL);
+
+  tids = malloc(threads * sizeof(pthread_t));
+  for (t=0; t!=threads; t++)
+    if (pthread_create(&tids[t], NULL, safe_worker, &s)) abort();
+  for (t=0; t!=threads; t++)
+    pthread_join(tids[t], NULL);
 
+  pthread_mutex_destroy(&s.lock);
+  free(tids);
   return *p;
 }
@@ -1,22 +1,356 @@
+#include <stdlib.h>
+
 #include "rsa.h"
 #include "rng.h"
 
+/*
+ * +-------------------+
+ * | 64-bit Montgomery |
+ * +-------------------+
+ */
+
+#ifdef RSA_NATIVE64
+
+typedef unsigned __int128 u128;
+
+/* t·2⁻⁶⁴ mod n, for t < n·2⁶⁴ */
+static inline uint64_t redc(u128 t, const struct mont64* k)
+{
+  uint64_t m = (uint64_t) t * k->ninv;
+  u128 mn = (u128) m * k->n;
+  /* the low halves add up to 0 mod 2⁶⁴, carrying unless both are 0 */
+  u128 r = (t >> 64) + (mn >> 64) + ((uint64_t) t != 0);
+
+  return r >= k->n ? r - k->n : r;
+}
+
+static inline uint64_t mul(uint64_t a, uint64_t b, const struct mont64* k)
+{
+  return redc((u128) a * b, k);
+}
+
+static uint64_t exp64(uint64_t b, uint64_t e, const struct mont64* k)
+{
+  uint64_t x, r;
+  int i;
+
+  /* into Montgomery form: x = b·2⁶⁴, r = 1·2⁶⁴ */
+  x = mul(b % k->n, k->r2, k);
+  r = mul(1, k->r2, k);
+  for (i=63 - (e ? __builtin_clzll(e) : 63); i>=0; i--) {
+    r = mul(r, r, k);
+    if (e >> i & 1) r = mul(r, x, k);
+  }
+  return redc(r, k);
+}
+
+#endif
+
+/**
+ * \brief Sets k up for the modulus n, if it is odd and fits in 64 bits.
+ *
+ * \return 1 if so, 0 (and k->n = 0) if n must go through BIGNUM.
+ */
+int mont64_set(struct mont64* k, const BIGNUM* n)
+{
+#ifdef RSA_NATIVE64
+  uint64_t x;
+  int i;
+
+  k->n = 0;
+  if (BN_is_negative(n) || BN_num_bits(n) > 64 || !BN_is_odd(n) || BN_is_one(n))
+    return 0;
+  k->n = BN_get_word(n);
+  /* n⁻¹ mod 2⁶⁴ by Newton: n·n = 1 mod 8, and each step doubles the bits */
+  x = k->n;
+  for (i=0; i!=5; i++)
+    x *= 2 - k->n * x;
+  k->ninv = -x;
+  k->r2 = (u128) -k->n % k->n;
+  k->r2 = (u128) k->r2 * k->r2 % k->n;
+  return 1;
+#else
+  k->n = 0;
+  return 0;
+#endif
+}
+
+/**
+ * \brief m = m^e mod n without BIGNUM arithmetic, for k set by \ref mont64_set().
+ *
+ * No allocation takes place, as m already holds a word.
+ *
+ * \return 1 if done, 0 if k, m or e do not fit, and m is left untouched.
+ */
+int mont64_exp(BIGNUM* m, const BIGNUM* e, const struct mont64* k)
+{
+#ifdef RSA_NATIVE64
+  if (!k->n || BN_is_negative(m) || BN_num_bits(m) > 64 ||
+      BN_is_negative(e) || BN_num_bits(e) > 64)
+    return 0;
+  BN_set_word(m, exp64(BN_get_word(m), BN_get_word(e), k));
+  return 1;
+#else
+  return 0;
+#endif
+}
+
+
+/*
+ * +----------------+
+ * | 512-bit Moduli |
+ * +----------------+
+ */
+
+/*
+ * Moduli that fill eight 64-bit limbs, as RSA512 keys and the primes of
+ * RSA1024 ones do, go through BN_mod_exp_mont_consttime(): on x86-64 that is
+ * libcrypto's fixed-size Montgomery assembly, with mulx/adx where the CPU has
+ * them, and a fixed window whose table is read in full at every step. It
+ * beats the sliding window of BN_mod_exp_mont() there, and does not leak d
+ * through its timing; smaller moduli are faster the other way.
+ */
+static int fills_512(const BIGNUM* n)
+{
+  int bits = BN_num_bits(n);
+
+  return BN_is_odd(n) && bits > 448 && bits <= 512;
+}
+
+/* r = a^e mod n, with mont the Montgomery form of n, or NULL; r != a */
+static int exp_mont(BIGNUM* r, const BIGNUM* a, const BIGNUM* e,
+                    const BIGNUM* n, BN_CTX* ctx, BN_MONT_CTX* mont)
+{
+  if (fills_512(n))
+    return BN_mod_exp_mont_consttime(r, a, e, n, ctx, mont);
+  return BN_mod_exp_mont(r, a, e, n, ctx, mont);
+}
+
+
+/*
+ * +------------+
+ * | Encryption |
+ * +------------+
+ */
+
+/**
+ * \brief m = m^e mod n; natively for moduli of up to 64 bits, by fixed windows
+ *        for moduli of 512.
+ */
 void rsa_encrypt(BIGNUM* m, const BIGNUM* e, const BIGNUM* n) {
+  struct mont64 k;
   BIGNUM* tmp;
   BN_CTX *ctx;
 
+  if (mont64_set(&k, n) && mont64_exp(m, e, &k)) return;
   ctx = BN_CTX_new();
   tmp = BN_new();
 
   BN_copy(tmp, m);
-  BN_mod_exp(m, tmp, e, n, ctx);
+  if (fills_512(n)) exp_mont(m, tmp, e, n, ctx, NULL);
+  else BN_mod_exp(m, tmp, e, n, ctx);
 
   BN_free(tmp);
   BN_CTX_free(ctx);
 }
 
 
-void rsa_genkey(int bits, BIGNUM* n, BIGNUM* phi, BIGNUM* e, BIGNUM* d)
+/**
+ * \brief Assembles a CRT key from its parts, taking ownership of them.
+ *
+ * \return the key, or NULL (and the parts freed) if p or q is even or zero.
+ */
+struct rsa_crt* rsa_crt_load(BIGNUM* p, BIGNUM* q,
+                             BIGNUM* dp, BIGNUM* dq, BIGNUM* qinv)
+{
+  struct rsa_crt* k;
+  BN_CTX* ctx;
+
+  k = malloc(sizeof(struct rsa_crt));
+  k->p = p;
+  k->q = q;
+  k->dp = dp;
+  k->dq = dq;
+  k->qinv = qinv;
+  ctx = BN_CTX_new();
+  k->mont_p = BN_MONT_CTX_new();
+  k->mont_q = BN_MONT_CTX_new();
+  if (!BN_MONT_CTX_set(k->mont_p, p, ctx) ||
+      !BN_MONT_CTX_set(k->mont_q, q, ctx)) {
+    rsa_crt_free(k);
+    k = NULL;
+  }
+  BN_CTX_free(ctx);
+  return k;
+}
+
+/**
+ * \brief Precomputes the CRT form of the private key d, for n = pq.
+ *
+ * \return the key, or NULL if p and q are not coprime.
+ */
+struct rsa_crt* rsa_crt_new(const BIGNUM* p, const BIGNUM* q, const BIGNUM* d)
+{
+  BIGNUM *dp, *dq, *qinv, *tmp;
+  BN_CTX* ctx;
+
+  dp = BN_new();
+  dq = BN_new();
+  qinv = BN_new();
+  ctx = BN_CTX_new();
+  tmp = BN_new();
+
+  /* dp = d mod (p-1), dq = d mod (q-1), qinv = q⁻¹ mod p */
+  BN_sub(tmp, p, BN_value_one());
+  BN_mod(dp, d, tmp, ctx);
+  BN_sub(tmp, q, BN_value_one());
+  BN_mod(dq, d, tmp, ctx);
+  BN_free(tmp);
+  if (!BN_mod_inverse(qinv, q, p, ctx)) {
+    BN_CTX_free(ctx);
+    BN_clear_free(dp);
+    BN_clear_free(dq);
+    BN_free(qinv);
+    return NULL;
+  }
+
+  BN_CTX_free(ctx);
+  return rsa_crt_load(BN_dup(p), BN_dup(q), dp, dq, qinv);
+}
+
+void rsa_crt_free(struct rsa_crt* k)
+{
+  if (!k) return;
+  BN_clear_free(k->p);
+  BN_clear_free(k->q);
+  BN_clear_free(k->dp);
+  BN_clear_free(k->dq);
+  BN_clear_free(k->qinv);
+  BN_MONT_CTX_free(k->mont_p);
+  BN_MONT_CTX_free(k->mont_q);
+  free(k);
+}
+
+/* m = m^d mod n by CRT, with the caller's ctx */
+static void crt_exp(BIGNUM* m, const struct rsa_crt* k, BN_CTX* ctx)
+{
+  BIGNUM *m1, *m2;
+
+  BN_CTX_start(ctx);
+  m1 = BN_CTX_get(ctx);
+  m2 = BN_CTX_get(ctx);
+
+  exp_mont(m1, m, k->dp, k->p, ctx, k->mont_p);
+  exp_mont(m2, m, k->dq, k->q, ctx, k->mont_q);
+  BN_mod_sub(m1, m1, m2, k->p, ctx);
+  BN_mod_mul(m1, m1, k->qinv, k->p, ctx);
+  BN_mul(m1, m1, k->q, ctx);
+  BN_add(m, m2, m1);
+
+  BN_CTX_end(ctx);
+}
+
+/**
+ * \brief Private-key operation, m = m^d mod n, by the Chinese Remainder Theorem.
+ *
+ * Two exponentiations with half-size moduli and exponents, each about an
+ * eighth of the work of the one with n and d, recombined by Garner's formula
+ *    m = m₂ + q·(qinv·(m₁ - m₂) mod p).
+ */
+void rsa_crt_decrypt(BIGNUM* m, const struct rsa_crt* k)
+{
+  BN_CTX* ctx;
+
+  ctx = BN_CTX_new();
+  crt_exp(m, k, ctx);
+  BN_CTX_free(ctx);
+}
+
+
+/*
+ * +-------------+
+ * | Cached Keys |
+ * +-------------+
+ */
+
+/**
+ * \brief Loads the key (e, n) for repeated use, with its CRT form if not NULL.
+ *
+ * The Montgomery form of n is computed once here rather than at every
+ * exponentiation, as \ref rsa_encrypt() does; the key takes ownership of crt.
+ *
+ * \return the key, or NULL if n has no Montgomery form; crt is freed then.
+ */
+struct rsa_key_ctx* rsa_key_new(const BIGNUM* e, const BIGNUM* n,
+                                struct rsa_crt* crt)
+{
+  struct rsa_key_ctx* k;
+
+  k = malloc(sizeof(struct rsa_key_ctx));
+  k->e = BN_dup(e);
+  k->n = BN_dup(n);
+  k->crt = crt;
+  k->ctx = BN_CTX_new();
+  k->mont = BN_MONT_CTX_new();
+  if (!BN_MONT_CTX_set(k->mont, n, k->ctx)) {
+    rsa_key_free(k);
+    return NULL;
+  }
+  mont64_set(&k->m64, n);
+  return k;
+}
+
+/**
+ * \brief Points *k at the key (e, n), reloading it only if it changed.
+ *
+ * \return 1 if the key was (re)loaded, 0 if *k already held it. *k is NULL
+ *         if the key could not be loaded, as in \ref rsa_key_new().
+ */
+int rsa_key_set(struct rsa_key_ctx** k, const BIGNUM* e, const BIGNUM* n)
+{
+  if (*k && !BN_cmp((*k)->e, e) && !BN_cmp((*k)->n, n)) return 0;
+  rsa_key_free(*k);
+  *k = rsa_key_new(e, n, NULL);
+  return 1;
+}
+
+void rsa_key_free(struct rsa_key_ctx* k)
+{
+  if (!k) return;
+  BN_clear_free(k->e);
+  BN_free(k->n);
+  rsa_crt_free(k->crt);
+  BN_MONT_CTX_free(k->mont);
+  BN_CTX_free(k->ctx);
+  free(k);
+}
+
+/** \brief m = m^e mod n: natively if n fits 64 bits, else by CRT if the key has it. */
+void rsa_key_exp(BIGNUM* m, struct rsa_key_ctx* k)
+{
+  BIGNUM* tmp;
+
+  if (mont64_exp(m, k->e, &k->m64)) return;
+  if (k->crt) {
+    crt_exp(m, k->crt, k->ctx);
+    return;
+  }
+  BN_CTX_start(k->ctx);
+  tmp = BN_CTX_get(k->ctx);
+  BN_copy(tmp, m);
+  exp_mont(m, tmp, k->e, k->n, k->ctx, k->mont);
+  BN_CTX_end(k->ctx);
+}
+
+/**
+ * \brief RSA key generation, from two safe primes.
+ *
+ * Each prime is searched for by threads workers at once. If crt is not NULL,
+ * the CRT form of the private key is stored there too.
+ */
+void rsa_genkey_parallel(int threads, int bits,
+                         BIGNUM* n, BIGNUM* phi, BIGNUM* e, BIGNUM* d,
+                         struct rsa_crt** crt)
 {
   BIGNUM
     *p,
@@ -34,21 +368,13 @@ void rsa_genkey(int bits, BIGNUM* n, BIGNUM* phi, BIGNUM* e, BIGNUM* d)
   p1 = BN_new();
   q1 = BN_new();
 
-  while (1) {
-    prng(&p, bits/2);
-    BN_sub(p1, p, BN_value_one());
-    BN_rshift1(tmp, p1);
-    if (!BN_is_prime(tmp, 10, NULL, NULL, NULL)) continue;
-    else break;
-  }
-
-  while (1) {
-    prng(&q, bits/2);
-    BN_sub(q1, q, BN_value_one());
-    BN_rshift1(tmp, q1);
-    if (!BN_is_prime(tmp, 10, NULL, NULL, NULL)) continue;
-    else break;
-  }
+  safe_prng(&p, bits/2, threads);
+  BN_sub(p1, p, BN_value_one());
+  /* p = q would leave no CRT form, and n a square */
+  do
+    safe_prng(&q, bits/2, threads);
+  while (!BN_cmp(p, q));
+  BN_sub(q1, q, BN_value_one());
 
   BN_mul(n, p, q, ctx);
   BN_mul(phi, p1, q1, ctx);
@@ -65,6 +391,7 @@ void rsa_genkey(int bits, BIGNUM* n, BIGNUM* phi, BIGNUM* e, BIGNUM* d)
     }
     BN_mod_inverse(d, e, phi, ctx);
   }
+  if (crt) *crt = rsa_crt_new(p, q, d);
 
   BN_CTX_free(ctx);
   BN_free(tmp);
@@ -0,0 +1,149 @@
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bitmatrix.h"
+
+/* schoolbook product, one entry at a time */
+static struct gf2matrix* naive_mul(const struct gf2matrix* a, const struct gf2matrix* b)
+{
+  struct gf2matrix* c;
+  size_t i, j, k;
+  int v;
+
+  c = gf2m_new(a->rows, b->cols);
+  for (i=0; i!=a->rows; i++)
+    for (j=0; j!=b->cols; j++) {
+      for (v=k=0; k!=a->cols; k++)
+        v ^= gf2m_get(a, i, k) & gf2m_get(b, k, j);
+      gf2m_set(c, i, j, v);
+    }
+  return c;
+}
+
+void test_mul(void)
+{
+  static const size_t sizes[][3] = {
+    {1, 1, 1}, {3, 7, 5}, {64, 64, 64}, {65, 130, 63}, {100, 257, 200},
+  };
+  struct gf2matrix *a, *b, *c, *expected, *id, *v;
+  uint64_t bx[5], y[2], z[2];
+  size_t s;
+
+  srand(3);
+  for (s=0; s!=sizeof(sizes)/sizeof(sizes[0]); s++) {
+    a = gf2m_random(sizes[s][0], sizes[s][1]);
+    b = gf2m_random(sizes[s][1], sizes[s][2]);
+    c = gf2m_new(sizes[s][0], sizes[s][2]);
+    expected = naive_mul(a, b);
+    assert(gf2m_equal(gf2m_mul(c, a, b), expected));
+
+    /* a·I = a */
+    id = gf2m_identity(sizes[s][1]);
+    gf2m_free(c);
+    c = gf2m_new(sizes[s][0], sizes[s][1]);
+    assert(gf2m_equal(gf2m_mul(c, a, id), a));
+
+    /* (a·b)·x = a·(b·x) */
+    v = gf2m_random(1, sizes[s][2]);
+    gf2m_mulvec(y, expected, gf2m_row(v, 0));
+    gf2m_mulvec(z, a, gf2m_mulvec(bx, b, gf2m_row(v, 0)));
+    assert(!memcmp(y, z, (sizes[s][0]/64 + 1) * sizeof(uint64_t)));
+    gf2m_free(v);
+
+    gf2m_free(id);
+    gf2m_free(a);
+    gf2m_free(b);
+    gf2m_free(c);
+    gf2m_free(expected);
+  }
+}
+
+void test_rank(void)
+{
+  struct gf2matrix *a, *b, *c, *e;
+  size_t i, j, r;
+
+  srand(5);
+  /* the product of n×r and r×m random matrices has rank r, mostly */
+  a = gf2m_random(300, 70);
+  b = gf2m_random(70, 250);
+  c = gf2m_new(300, 250);
+  gf2m_mul(c, a, b);
+  r = gf2m_rank(c);
+  assert(r <= 70 && r >= 68);
+
+  /* reduced echelon form: each pivot is alone in its column */
+  e = gf2m_copy(c);
+  assert(gf2m_echelon(e, 1) == r);
+  for (i=0; i!=r; i++) {
+    for (j=0; !gf2m_get(e, i, j); j++) ;
+    assert(gf2m_get(e, i, j));
+  }
+  for (i=r; i!=e->rows; i++)
+    for (j=0; j!=e->cols; j++)
+      assert(!gf2m_get(e, i, j));
+
+  gf2m_free(a);
+  gf2m_free(b);
+  gf2m_free(c);
+  gf2m_free(e);
+}
+
+void test_solve(void)
+{
+  struct gf2matrix *a, *inv, *prod, *id;
+  uint64_t x[4], b[4], y[4], sol[4];
+  size_t i, n;
+
+  srand(9);
+  for (n=1; n<=200; n += 33) {
+    /* random square matrices are invertible with probability about 0.29 */
+    for (a=NULL; !a || gf2m_rank(a) != n; a = gf2m_random(n, n))
+      gf2m_free(a);
+
+    inv = gf2m_new(n, n);
+    prod = gf2m_new(n, n);
+    id = gf2m_identity(n);
+    assert(gf2m_inverse(inv, a) == inv);
+    assert(gf2m_equal(gf2m_mul(prod, a, inv), id));
+
+    memset(x, 0, sizeof(x));
+    for (i=0; i!=n; i++)
+      x[i/64] |= (uint64_t) (rand() & 1) << (i%64);
+    gf2m_mulvec(b, a, x);
+    assert(gf2m_solve(sol, a, b) == 0);
+    assert(!memcmp(sol, x, (n/64 + 1) * sizeof(uint64_t)));
+    gf2m_mulvec(y, inv, b);
+    assert(!memcmp(y, x, (n/64 + 1) * sizeof(uint64_t)));
+
+    gf2m_free(a);
+    gf2m_free(inv);
+    gf2m_free(prod);
+    gf2m_free(id);
+  }
+
+  /* singular and inconsistent systems */
+  a = gf2m_new(3, 3);
+  gf2m_set(a, 0, 0, 1);
+  gf2m_set(a, 1, 0, 1);
+  gf2m_set(a, 2, 2, 1);
+  inv = gf2m_new(3, 3);
+  assert(!gf2m_inverse(inv, a));
+  b[0] = 1 | 1 << 2;
+  assert(gf2m_solve(sol, a, b) == -1);
+  b[0] = 1 | 2 | 4;
+  assert(gf2m_solve(sol, a, b) == 1);
+  assert(sol[0] == (1 | 4));
+  gf2m_free(a);
+  gf2m_free(inv);
+}
+
+int main(int argc, char** argv)
+{
+  test_mul();
+  test_rank();
+  test_solve();
+  return 0;
+}
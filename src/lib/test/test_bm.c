@@ -0,0 +1,112 @@
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bm.h"
+#include "lfsr.h"
+
+/* textbook Berlekamp–Massey, one bit per byte */
+static size_t naive_bm(const char* s, size_t n, size_t* profile)
+{
+  char *c, *b, *t;
+  size_t i, N, L;
+  long m;
+  char d;
+
+  c = calloc(n+1, 1);
+  b = calloc(n+1, 1);
+  t = malloc(n+1);
+  c[0] = b[0] = 1;
+  L = 0;
+  m = -1;
+  for (N=0; N!=n; N++) {
+    for (d=s[N], i=1; i<=L; i++)
+      d ^= c[i] & s[N-i];
+    if (d) {
+      memcpy(t, c, n+1);
+      for (i=0; i + N-m <= n; i++)
+        c[i + N-m] ^= b[i];
+      if (2*L <= N) {
+        L = N + 1 - L;
+        m = N;
+        memcpy(b, t, n+1);
+      }
+    }
+    profile[N] = L;
+  }
+
+  free(c);
+  free(b);
+  free(t);
+  return L;
+}
+
+void test_simple(void)
+{
+  char s[200];
+  uint64_t packed[4];
+
+  memset(s, 0, sizeof(s));
+  assert(linear_complexity(pack_bits(packed, s, 200), 200, NULL) == 0);
+
+  /* 0, …, 0, 1 can only come from a register as long as the sequence */
+  s[199] = 1;
+  assert(linear_complexity(pack_bits(packed, s, 200), 200, NULL) == 200);
+  s[199] = 0;
+  s[127] = 1;
+  assert(linear_complexity(pack_bits(packed, s, 128), 128, NULL) == 128);
+
+  memset(s, 1, sizeof(s));
+  assert(linear_complexity(pack_bits(packed, s, 200), 200, NULL) == 1);
+}
+
+void test_lfsr(void)
+{
+  char s[1000];
+  char reg[23];
+  uint64_t packed[16];
+  char* p = "\1\0\0\0\0\0\0\0\1\0\0\0\0\0\0\0\0\0\0\0\0\1\1\1";
+
+  memset(reg, 0, sizeof(reg));
+  reg[5] = 1;
+  LFSR(s, p, 23, reg, 1000);
+  assert(linear_complexity(pack_bits(packed, s, 1000), 1000, NULL) == 23);
+}
+
+void test_random(void)
+{
+  static char s[3000];
+  static uint64_t packed[50];
+  static size_t expected[3000], profile[3000];
+  char key[64];
+  size_t i, n;
+  static const size_t lengths[] = {1, 63, 64, 65, 127, 128, 129, 1000, 3000};
+
+  srand(42);
+  for (n=0; n!=sizeof(lengths)/sizeof(size_t); n++) {
+    for (i=0; i!=lengths[n]; i++)
+      s[i] = rand() & 1;
+    pack_bits(packed, s, lengths[n]);
+    assert(linear_complexity(packed, lengths[n], profile) ==
+           naive_bm(s, lengths[n], expected));
+    assert(!memcmp(profile, expected, lengths[n] * sizeof(size_t)));
+  }
+
+  for (i=0; i!=64; i++)
+    key[i] = rand() & 1;
+  maj5(s, key, 3000);
+  assert(linear_complexity(pack_bits(packed, s, 3000), 3000, profile) ==
+         naive_bm(s, 3000, expected));
+  assert(!memcmp(profile, expected, sizeof(profile)));
+}
+
+
+int main(int argc, char** argv)
+{
+  test_simple();
+  test_lfsr();
+  test_random();
+
+  return 0;
+}
@@ -1,4 +1,7 @@
 #include <assert.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
 #include <openssl/bn.h>
 
 #include "rsa.h"
@@ -6,7 +9,7 @@
 
 void test_bn_rng(void)
 {
-  BIGNUM *n;
+  BIGNUM *n = NULL;
 
   bn_rng(&n, 16);
   assert(n);
@@ -16,6 +19,68 @@ void test_bn_rng(void)
   BN_free(n);
 }
 
+/* draws never repeat, across pool refills and across fork() */
+void test_entropy(void)
+{
+  static unsigned char big[3][5000];
+  unsigned char a[16], b[16], zero[16] = {0};
+  int fds[2], status;
+  size_t i;
+
+  for (i=0; i!=1000; i++) {
+    entropy(a, sizeof(a));
+    entropy(b, sizeof(b));
+    assert(memcmp(a, b, sizeof(a)) && memcmp(a, zero, sizeof(a)));
+  }
+  entropy(big[0], sizeof(big[0]));
+  entropy(big[1], 4093);
+  entropy(big[2], sizeof(big[2]));
+  assert(memcmp(big[0], big[2], sizeof(big[0])));
+
+  assert(!pipe(fds));
+  entropy(a, 1);
+  if (!fork()) {
+    entropy(a, sizeof(a));
+    write(fds[1], a, sizeof(a));
+    _exit(0);
+  }
+  entropy(b, sizeof(b));
+  assert(read(fds[0], a, sizeof(a)) == sizeof(a));
+  wait(&status);
+  assert(memcmp(a, b, sizeof(a)));
+}
+
+/* streams do not depend on how they are drawn, and leave nothing behind */
+void test_drbg(void)
+{
+  static unsigned char once[10000], chunked[10000], other[10000];
+  static struct drbg_ctx a, b;
+  size_t i, n;
+
+  srng((char*) once, "seed", sizeof(once));
+  drbg_seed(&a, "seed");
+  for (i=n=0; n!=sizeof(chunked); i = i*3 + 1) {
+    if (i > sizeof(chunked) - n) i = sizeof(chunked) - n;
+    drbg_generate(&a, chunked + n, i);
+    n += i;
+  }
+  assert(!memcmp(once, chunked, sizeof(once)));
+  for (i=0; i!=sizeof(a.buf) - a.left; i++)
+    assert(!a.buf[i]);
+
+  /* short requests are served whole */
+  srng((char*) other, "seed", 7);
+  assert(!memcmp(once, other, 7));
+  srng((char*) other, "seee", sizeof(other));
+  assert(memcmp(once, other, sizeof(other)));
+
+  drbg_init(&a);
+  drbg_init(&b);
+  drbg_generate(&a, once, sizeof(once));
+  drbg_generate(&b, other, sizeof(other));
+  assert(memcmp(once, other, sizeof(once)));
+}
+
 void test_bn_prng(void)
 {
   BIGNUM *n = NULL;
@@ -42,11 +107,229 @@ void test_rsa_genkey(void)
   BN_free(e);
 }
 
+/* the CRT form of the private key decrypts just as d does */
+void test_rsa_crt(void)
+{
+  BIGNUM
+    *n = BN_new(),
+    *phi = BN_new(),
+    *e = BN_new(),
+    *d = BN_new(),
+    *m = NULL,
+    *x = BN_new(),
+    *y = BN_new();
+  struct rsa_crt* crt;
+  int bits, i;
+
+  for (bits=64; bits<=512; bits*=2) {
+    rsa_genkey_parallel(1, bits, n, phi, e, d, &crt);
+    assert(crt);
+    for (i=0; i!=10; i++) {
+      bn_rng(&m, bits/2);
+      BN_copy(x, m);
+      rsa_encrypt(x, e, n);
+      BN_copy(y, x);
+      rsa_decrypt(x, d, n);
+      rsa_crt_decrypt(y, crt);
+      assert(!BN_cmp(x, m) && !BN_cmp(y, m));
+    }
+    rsa_crt_free(crt);
+  }
+
+  BN_free(n);
+  BN_free(phi);
+  BN_free(e);
+  BN_free(d);
+  BN_free(m);
+  BN_free(x);
+  BN_free(y);
+}
+
+/* a cached key gives what rsa_encrypt() does, by d or by CRT */
+void test_rsa_key(void)
+{
+  BIGNUM
+    *n = BN_new(),
+    *phi = BN_new(),
+    *e = BN_new(),
+    *d = BN_new(),
+    *m = NULL,
+    *x = BN_new(),
+    *y = BN_new();
+  struct rsa_crt* crt;
+  struct rsa_key_ctx *pub = NULL, *priv, *fast;
+  int i;
+
+  rsa_genkey_parallel(1, 256, n, phi, e, d, &crt);
+  assert(rsa_key_set(&pub, e, n) == 1);
+  assert(rsa_key_set(&pub, e, n) == 0);
+  priv = rsa_key_new(d, n, NULL);
+  fast = rsa_key_new(d, n, crt);
+  for (i=0; i!=20; i++) {
+    bn_rng(&m, 128);
+    BN_copy(x, m);
+    rsa_encrypt(x, e, n);
+    BN_copy(y, m);
+    rsa_key_exp(y, pub);
+    assert(!BN_cmp(x, y));
+    rsa_key_exp(y, priv);
+    rsa_key_exp(x, fast);
+    assert(!BN_cmp(x, m) && !BN_cmp(y, m));
+  }
+  /* a different key is reloaded */
+  assert(rsa_key_set(&pub, d, n) == 1);
+  rsa_key_exp(y, pub);
+  rsa_key_exp(y, fast);
+
+  rsa_key_free(pub);
+  rsa_key_free(priv);
+  rsa_key_free(fast);
+  /* an even modulus has no Montgomery form */
+  BN_add_word(n, 1);
+  assert(!rsa_key_new(e, n, NULL));
+  pub = NULL;
+  assert(rsa_key_set(&pub, e, n) == 1 && !pub);
+  BN_free(n);
+  BN_free(phi);
+  BN_free(e);
+  BN_free(d);
+  BN_free(m);
+  BN_free(x);
+  BN_free(y);
+}
+
+/* the native path for moduli of up to 64 bits agrees with BIGNUM */
+void test_rsa64(void)
+{
+  static const char* moduli[] = {
+    "3", "5", "FFFFFFFB", "100000001", "794D23A3CED5E8D9",
+    "FFFFFFFFFFFFFFC5", "FFFFFFFFFFFFFFFF", "8000000000000001",
+  };
+  BIGNUM
+    *n = NULL,
+    *m = BN_new(),
+    *e = BN_new(),
+    *x = BN_new(),
+    *y = BN_new();
+  BN_CTX* ctx = BN_CTX_new();
+  struct mont64 k;
+  size_t i, j;
+
+  for (i=0; i!=sizeof(moduli)/sizeof(moduli[0]); i++) {
+    BN_hex2bn(&n, moduli[i]);
+    assert(mont64_set(&k, n) == 1);
+    for (j=0; j!=200; j++) {
+      /* bases past n, and exponents down to 0 */
+      BN_rand(m, 1 + j % 64, BN_RAND_TOP_ANY, BN_RAND_BOTTOM_ANY);
+      BN_rand(e, 1 + j * 7 % 64, BN_RAND_TOP_ANY, BN_RAND_BOTTOM_ANY);
+      if (j == 0) BN_zero(e);
+      if (j == 1) BN_zero(m);
+      BN_mod_exp(y, m, e, n, ctx);
+      BN_copy(x, m);
+      assert(mont64_exp(x, e, &k) == 1);
+      assert(!BN_cmp(x, y));
+      BN_copy(x, m);
+      rsa_encrypt(x, e, n);
+      assert(!BN_cmp(x, y));
+    }
+  }
+
+  /* even, or too wide: left to BIGNUM */
+  BN_hex2bn(&n, "FFFFFFFFFFFFFFFE");
+  assert(mont64_set(&k, n) == 0);
+  assert(mont64_exp(x, e, &k) == 0);
+  BN_hex2bn(&n, "10000000000000001");
+  assert(mont64_set(&k, n) == 0);
+  BN_hex2bn(&n, "FFFFFFFFFFFFFFC5");
+  mont64_set(&k, n);
+  BN_hex2bn(&m, "10000000000000000");
+  BN_copy(x, m);
+  assert(mont64_exp(x, e, &k) == 0 && !BN_cmp(x, m));
+
+  BN_free(n);
+  BN_free(m);
+  BN_free(e);
+  BN_free(x);
+  BN_free(y);
+  BN_CTX_free(ctx);
+}
+
+/* 512-bit moduli, by fixed windows, give just what BN_mod_exp() does */
+void test_rsa512(void)
+{
+  BIGNUM
+    *n = BN_new(),
+    *m = BN_new(),
+    *e = BN_new(),
+    *x = BN_new(),
+    *y = BN_new(),
+    *phi = BN_new(),
+    *d = BN_new();
+  BN_CTX* ctx = BN_CTX_new();
+  struct rsa_key_ctx* key;
+  struct rsa_crt* crt;
+  size_t i, j;
+
+  for (i=0; i!=10; i++) {
+    /* odd, from 449 bits up to 512, and last 2⁵¹² - 1 */
+    BN_rand(n, 449 + i * 63 / 9, BN_RAND_TOP_ONE, BN_RAND_BOTTOM_ODD);
+    if (i == 9) {
+      BN_set_word(n, 1);
+      BN_lshift(n, n, 512);
+      BN_sub_word(n, 1);
+    }
+    key = rsa_key_new(e, n, NULL);
+    for (j=0; j!=10; j++) {
+      /* bases past n, and exponents from 0 up */
+      BN_rand(m, 1 + (i + j * 53) % 520, BN_RAND_TOP_ANY, BN_RAND_BOTTOM_ANY);
+      BN_rand(e, 1 + (i * 31 + j * 71) % 512, BN_RAND_TOP_ANY, BN_RAND_BOTTOM_ANY);
+      if (j == 0) BN_zero(e);
+      if (j == 1) BN_zero(m);
+      BN_mod_exp(y, m, e, n, ctx);
+      BN_copy(x, m);
+      rsa_encrypt(x, e, n);
+      assert(!BN_cmp(x, y));
+      BN_copy(key->e, e);
+      BN_copy(x, m);
+      rsa_key_exp(x, key);
+      assert(!BN_cmp(x, y));
+    }
+    rsa_key_free(key);
+  }
+
+  /* and so do the primes of RSA1024 keys */
+  rsa_genkey_parallel(1, 1024, n, phi, e, d, &crt);
+  key = rsa_key_new(d, n, crt);
+  for (i=0; i!=5; i++) {
+    BN_rand_range(m, n);
+    BN_mod_exp(y, m, d, n, ctx);
+    BN_copy(x, m);
+    rsa_key_exp(x, key);
+    assert(!BN_cmp(x, y));
+  }
+  rsa_key_free(key);
+
+  BN_free(n);
+  BN_free(m);
+  BN_free(e);
+  BN_free(x);
+  BN_free(y);
+  BN_free(phi);
+  BN_free(d);
+  BN_CTX_free(ctx);
+}
+
 int main(int argc, char **argv)
 {
   test_bn_rng();
+  test_entropy();
+  test_drbg();
   test_bn_prng();
   test_rsa_genkey();
+  test_rsa_crt();
+  test_rsa_key();
+  test_rsa64();
+  test_rsa512();
   return 0;
 
 }
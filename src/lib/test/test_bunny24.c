@@ -346,6 +346,26 @@ void test_reduced_bunny24(void)
   assert(!memcmp(m, "\x27\x58\x3C", 3 * sizeof(char)));
 }
 
+/* the table-driven block encryption agrees with the reference one */
+void test_encrypt_block(void)
+{
+  struct bunny24_key k;
+  unsigned char key[3], m[3], c[3];
+  uint32_t x;
+  size_t i, j;
+
+  srand(24);
+  for (i=0; i!=50; i++) {
+    for (j=0; j!=3; j++) key[j] = rand();
+    bunny24_setkey(&k, (char*) key);
+    for (j=0; j!=20; j++) {
+      x = rand() & 0xffffff;
+      m[0] = x >> 16; m[1] = x >> 8; m[2] = x;
+      bunny24_encrypt((char*) c, (char*) key, (char*) m);
+      assert(bunny24_encrypt_block(&k, x) == (c[0] << 16 | c[1] << 8 | c[2]));
+    }
+  }
+}
 
 
 int main(int argc, char ** argv)
@@ -362,5 +382,6 @@ int main(int argc, char ** argv)
   test_bunny24_cbc_decrypt();
 
   test_reduced_bunny24();
+  test_encrypt_block();
   return 0;
 }
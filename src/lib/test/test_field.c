@@ -93,6 +93,57 @@ int test_rotate(void)
 }
 
 
+int test_polynomials(void)
+{
+  f2poly a, m;
+  size_t i;
+
+  assert(f2deg(0) == -1);
+  assert(f2deg(1) == 0);
+  assert(f2deg((f2poly) 1 << 100 | 3) == 100);
+
+  /* x³ + x + 1 is primitive: x has order 7 */
+  m = btoi("1011");
+  assert(f2expmod(m, 2, 3) == btoi("11"));
+  assert(f2expmod(m, 2, 7) == 1);
+  assert(f2mod((f2poly) 1 << 7, m) == 1);
+
+  /* x⁶⁴ + x⁴ + x³ + x + 1 is irreducible: x^(2⁶⁴) = x */
+  m = (f2poly) 1 << 64 | btoi("11011");
+  for (a=2, i=0; i!=64; i++)
+    a = f2mulmod(m, a, a);
+  assert(a == 2);
+
+  return 1;
+}
+
+int test_order(void)
+{
+  /* x³ + x + 1, x⁴ + x³ + x² + x + 1, (x + 1)³, x(x + 1) */
+  assert(f2order(btoi("1011")) == 7);
+  assert(f2primitive(btoi("1011")));
+  assert(f2order(btoi("11111")) == 5);
+  assert(f2irreducible(btoi("11111")));
+  assert(!f2primitive(btoi("11111")));
+  assert(f2order(btoi("1111")) == 4);
+  assert(!f2irreducible(btoi("1111")));
+  assert(f2order(btoi("110")) == 0);
+
+  /* (x² + x + 1)(x³ + x + 1)²: lcm(3, 7)·2 */
+  assert(f2order(f2mulmod((f2poly) 1 << 64, btoi("111"),
+                          f2mulmod((f2poly) 1 << 64, btoi("1011"), btoi("1011"))))
+         == 42);
+
+  /* x⁶⁴ + x⁴ + x³ + x + 1 and x³² + x²² + x² + x + 1 are primitive */
+  assert(f2primitive((f2poly) 1 << 64 | btoi("11011")));
+  assert(f2order((f2poly) 1 << 32 | 1 << 22 | btoi("111")) == 0xffffffff);
+  /* x⁶³ + 1 = Π of all irreducibles of degree dividing 6 */
+  assert(f2order((f2poly) 1 << 63 | 1) == 63);
+
+  return 1;
+}
+
+
 int main(int argc, char ** argv)
 {
   test_type();
@@ -101,6 +152,8 @@ int main(int argc, char ** argv)
   test_sum();
   test_rotate();
   test_exponential();
+  test_polynomials();
+  test_order();
 
   return 0;
 }
@@ -214,12 +214,297 @@ void test_vector_a51(void)
                  "\0\1\1\0\1\1\1\1\1\0\0\0\1\1\0\1\0\1", 228));
 }
 
+/*
+ * Shorter outputs shall be prefixes of longer ones, whatever the length:
+ * stresses lookahead steps crossing the end of the output.
+ */
+void test_prefix(void)
+{
+  char* key = "\0\1\0\0\1\0\0\0\1\1\0\0\0\1\0\0\1\0\1\0\0\0\1\0\1\1\1\0\0"
+    "\1\1\0\1\0\0\1\0\0\0\1\1\1\0\1\0\1\0\1\1\0\1\1\0\0\1\1\1\1\1\1\0\1\1\1";
+  char full[300];
+  char dst[300];
+  size_t n;
+
+  for (n=1; n<300; n+=7) {
+    maj5(full, key, 300);
+    maj5(dst, key, n);
+    assert(!memcmp(dst, full, n));
+
+    a5_1(full, key, 300);
+    a5_1(dst, key, n);
+    assert(!memcmp(dst, full, n));
+
+    all5(full, key, 300);
+    all5(dst, key, n);
+    assert(!memcmp(dst, full, n));
+  }
+}
+
+void test_jump(void)
+{
+  char output[5000];
+  char reg[23];
+  char jumped[23];
+  size_t i;
+  static const size_t steps[] = {0, 1, 5, 100, 2047, 2048, 5000};
+  char* p = "\1\0\0\0\0\0\0\0\1\0\0\0\0\0\0\0\0\0\0\0\0\1\1\1";
+
+  for (i=0; i!=sizeof(steps)/sizeof(size_t); i++) {
+    memcpy(reg, "\1\0\1\1\1\1\0\0\0\1\1\0\0\1\0\1\0\0\0\1\1\0\1", 23);
+    memcpy(jumped, reg, 23);
+    LFSR(output, p, 23, reg, steps[i]);
+    lfsr_jump(jumped, p, 23, steps[i]);
+    assert(!memcmp(reg, jumped, 23));
+  }
+}
+
+void test_all5_seek(void)
+{
+  char* key = "\0\1\0\0\1\0\0\0\1\1\0\0\0\1\0\0\1\0\1\0\0\0\1\0\1\1\1\0\0"
+    "\1\1\0\1\0\0\1\0\0\0\1\1\1\0\1\0\1\0\1\1\0\1\1\0\0\1\1\1\1\1\1\0\1\1\1";
+  static char full[100000];
+  static char dst[100000];
+  size_t offset;
+
+  all5(full, key, 100000);
+  for (offset=0; offset<1000; offset+=37) {
+    all5_seek(dst, key, offset, 1000);
+    assert(!memcmp(dst, full + offset, 1000));
+  }
+  all5_seek(dst, key, 99000, 1000);
+  assert(!memcmp(dst, full + 99000, 1000));
+
+  all5_parallel(dst, key, 300, 4);
+  assert(!memcmp(dst, full, 300));
+  all5_parallel(dst, key, 100000, 7);
+  assert(!memcmp(dst, full, 100000));
+}
+
+void test_order(void)
+{
+  char p[65];
+  size_t degree;
+  unsigned long taps, i;
+
+  /* cross-check against stepping, for every invertible register */
+  for (degree=1; degree<=12; degree++)
+    for (taps=0; taps != 1ul << (degree-1); taps++) {
+      p[0] = 1;
+      for (i=1; i!=degree; i++)
+        p[i] = taps >> (i-1) & 1;
+      p[degree] = 1;
+      assert(lfsr_order(p, degree) == lfsr_period(p, degree));
+    }
+
+  /* x^64 + x^4 + x^3 + x + 1 */
+  memset(p, 0, sizeof(p));
+  p[0] = p[60] = p[61] = p[63] = p[64] = 1;
+  assert(lfsr_order(p, 64) == UINT64_MAX);
+  /* not invertible */
+  p[64] = 0;
+  assert(lfsr_order(p, 64) == 0);
+}
+
+void test_key_loading(void)
+{
+  static char keys[64*10];
+  uint64_t states[5*10];
+  char reg[23], out;
+  size_t t, i, j;
+  static const size_t degrees[5] = {19, 22, 23, 11, 13};
+  static const char* polys[5] = {
+    "\1\0\0\0\0\0\0\0\0\0\0\0\0\0\1\0\0\1\1\1",
+    "\1\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\1\1",
+    "\1\0\0\0\0\0\0\0\1\0\0\0\0\0\0\0\0\0\0\0\0\1\1\1",
+    "\1\0\1\0\0\0\0\0\0\0\0\1",
+    "\1\1\0\1\1\0\0\0\0\0\0\0\0\1",
+  };
+  const char* frame = "\0\0\1\0\1\1\0\0\1\0\0\0\0\0\0\0\0\0\0\0\0\0";
+
+  srand(11);
+  for (i=0; i!=sizeof(keys); i++)
+    keys[i] = rand() & 1;
+  lfsr_key_loading(states, keys, 10);
+
+  /* reference: 64 + 22 regular clocks, injecting in the first position */
+  for (t=0; t!=10; t++)
+    for (j=0; j!=5; j++) {
+      memset(reg, 0, sizeof(reg));
+      for (i=0; i!=64 + 22; i++) {
+        LFSR(&out, polys[j], degrees[j], reg, 1);
+        reg[0] ^= i < 64 ? keys[64*t + i] : frame[i - 64];
+      }
+      for (i=0; i!=degrees[j]; i++)
+        assert((states[5*t + j] >> i & 1) == reg[i]);
+    }
+}
+
+void test_bytes(void)
+{
+  char* key = "\1\0\1\1\0\0\1\0\1\1\1\0\0\0\1\0\1\0\0\1\1\0\1\0\0\0\0\1\1"
+    "\1\0\1\1\0\1\0\0\1\0\0\1\1\1\0\1\0\0\0\1\1\0\1\1\0\0\1\0\1\0\1\1\1\0";
+  static char bits[8*1001];
+  static unsigned char packed[1001];
+  static char plain[1001], cipher[1001];
+  unsigned char c;
+  size_t g, n, i, j;
+  struct stream_ctx ctx;
+  char* (*generators[3])(char*, const char*, size_t) = {maj5, all5, a5_1};
+  unsigned char* (*packers[3])(unsigned char*, const char*, size_t) =
+    {maj5_bytes, all5_bytes, a5_1_bytes};
+  static const size_t lengths[] = {1, 2, 7, 8, 9, 13, 64, 1001};
+
+  for (g=0; g!=3; g++)
+    for (n=0; n!=sizeof(lengths)/sizeof(size_t); n++) {
+      generators[g](bits, key, 8*lengths[n]);
+      packers[g](packed, key, lengths[n]);
+      for (i=0; i!=lengths[n]; i++) {
+        for (c=0, j=8*i; j!=8*(i+1); j++)
+          c = c<<1 | bits[j];
+        assert(packed[i] == c);
+      }
+    }
+
+  /* encryption and decryption, also in place */
+  for (i=0; i!=sizeof(plain); i++)
+    plain[i] = i * 7;
+  stream_init(&ctx, STREAM_MAJ5, key);
+  stream_xor(&ctx, cipher, plain, sizeof(plain));
+  maj5_bytes(packed, key, sizeof(packed));
+  for (i=0; i!=sizeof(plain); i++)
+    assert((unsigned char) (cipher[i] ^ plain[i]) == packed[i]);
+  stream_init(&ctx, STREAM_MAJ5, key);
+  stream_xor(&ctx, cipher, cipher, sizeof(cipher));
+  assert(!memcmp(cipher, plain, sizeof(plain)));
+}
+
+void test_ctx(void)
+{
+  char* key = "\0\1\1\0\1\0\0\1\1\1\0\1\0\0\0\1\1\0\1\0\1\1\0\0\1\0\1\0\0"
+    "\1\1\0\0\0\1\0\1\1\0\1\0\0\1\1\0\1\1\0\0\0\1\1\1\0\1\0\0\1\1\1\0\0\1\0";
+  static char expected[200000], bits[200000];
+  static unsigned char packed[1000];
+  static char plain[10000], once[10000], chunked[10000];
+  static const size_t chunks[] = {1, 7, 64, 1000, 70000, 8, 128};
+  struct maj5_ctx maj5_ctx;
+  struct all5_ctx all5_ctx;
+  struct a5_1_ctx a5_1_ctx;
+  struct stream_ctx ctx;
+  unsigned char c;
+  size_t i, j, n, g;
+
+  /* a few chunks of bits, then a few bytes */
+  for (g=0; g!=3; g++) {
+    switch (g) {
+    case 0: maj5(expected, key, sizeof(expected)); maj5_init(&maj5_ctx, key); break;
+    case 1: all5(expected, key, sizeof(expected)); all5_init(&all5_ctx, key); break;
+    case 2: a5_1(expected, key, sizeof(expected)); a5_1_init(&a5_1_ctx, key); break;
+    }
+    for (i=n=0; i!=sizeof(chunks)/sizeof(size_t); n += chunks[i++])
+      switch (g) {
+      case 0: maj5_next(&maj5_ctx, bits + n, chunks[i]); break;
+      case 1: all5_next(&all5_ctx, bits + n, chunks[i]); break;
+      case 2: a5_1_next(&a5_1_ctx, bits + n, chunks[i]); break;
+      }
+    assert(!memcmp(bits, expected, n));
+    switch (g) {
+    case 0: maj5_next_bytes(&maj5_ctx, packed, sizeof(packed)); break;
+    case 1: all5_next_bytes(&all5_ctx, packed, sizeof(packed)); break;
+    case 2: a5_1_next_bytes(&a5_1_ctx, packed, sizeof(packed)); break;
+    }
+    for (i=0; i!=sizeof(packed); i++) {
+      for (c=0, j=n + 8*i; j!=n + 8*(i+1); j++)
+        c = c<<1 | expected[j];
+      assert(packed[i] == c);
+    }
+  }
+
+  /* encrypting in chunks is the same as encrypting at once */
+  for (i=0; i!=sizeof(plain); i++)
+    plain[i] = i ^ (i >> 8);
+  for (g=STREAM_MAJ5; g<=STREAM_A5_1; g++) {
+    stream_xor(stream_init(&ctx, g, key), once, plain, sizeof(plain));
+    stream_init(&ctx, g, key);
+    for (i=n=0; n < sizeof(plain); n += 3*i + 1, i++)
+      stream_xor(&ctx, chunked + n, plain + n,
+                 n + 3*i + 1 < sizeof(plain) ? 3*i + 1 : sizeof(plain) - n);
+    assert(!memcmp(once, chunked, sizeof(plain)));
+  }
+}
+
+void test_x64(void)
+{
+  static char keys[64*64];
+  static uint64_t sliced[500];
+  char expected[500];
+  size_t i, l;
+
+  srand(7);
+  for (i=0; i!=sizeof(keys); i++)
+    keys[i] = rand() & 1;
+
+  maj5_x64(sliced, keys, 500);
+  for (l=0; l!=64; l++) {
+    maj5(expected, keys + 64*l, 500);
+    for (i=0; i!=500; i++)
+      assert((sliced[i] >> l & 1) == expected[i]);
+  }
+
+  a5_1_x64(sliced, keys, 500);
+  for (l=0; l!=64; l++) {
+    a5_1(expected, keys + 64*l, 500);
+    for (i=0; i!=500; i++)
+      assert((sliced[i] >> l & 1) == expected[i]);
+  }
+
+  all5_x64(sliced, keys, 500);
+  for (l=0; l!=64; l++) {
+    all5(expected, keys + 64*l, 500);
+    for (i=0; i!=500; i++)
+      assert((sliced[i] >> l & 1) == expected[i]);
+  }
+}
+
+void test_output(void)
+{
+  struct all5_ctx ctx;
+  uint64_t x[5][1000/64 + 1];
+  char key[64], expected[1000];
+  size_t i, j;
+  int b[5];
+
+  srand(11);
+  for (i=0; i!=64; i++)
+    key[i] = rand() & 1;
+  all5(expected, key, 1000);
+  all5_init(&ctx, key);
+  for (j=0; j!=5; j++)
+    lfsr_output(x[j], j, ctx.states[j], 1000);
+
+  /* the keystream combines the register outputs */
+  for (i=0; i!=1000; i++) {
+    for (j=0; j!=5; j++)
+      b[j] = x[j][i/64] >> (i%64) & 1;
+    assert(expected[i] == ((b[0]&b[3]) ^ (b[1]&b[2]) ^ (b[1]&b[4]) ^ (b[2]&b[3])));
+  }
+}
+
 int main(int argc, char** argv)
 {
   test_period();
+  test_order();
   test_vector_lfsr();
   test_vector_maj5();
   test_vector_all5();
   test_vector_a51();
+  test_prefix();
+  test_jump();
+  test_all5_seek();
+  test_key_loading();
+  test_bytes();
+  test_ctx();
+  test_x64();
+  test_output();
   return 0;
  }
@@ -0,0 +1,112 @@
+#include <assert.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "rng.h"
+
+/* outputs of the reference mt19937ar.c, seeded by init_genrand(5489) */
+void test_reference(void)
+{
+  struct mt_ctx ctx;
+  size_t i;
+  uint32_t y;
+
+  mt_init(&ctx, 5489);
+  assert(mt_next(&ctx) == 3499211612u);
+  assert(mt_next(&ctx) == 581869302u);
+  assert(mt_next(&ctx) == 3890346734u);
+  for (i=3; i!=9999; i++)
+    mt_next(&ctx);
+  y = mt_next(&ctx);
+  assert(y == 4123659995u);
+}
+
+void test_fill(void)
+{
+  static uint32_t once[3000], chunked[3000];
+  static unsigned char bytes[4*700 + 3];
+  struct mt_ctx a, b;
+  size_t i, n;
+  uint32_t y;
+  char seed[4] = {1, 2, 3, 4};
+
+  /* bulk fills, in any chunks, match single draws */
+  mt_init(&a, 42);
+  for (i=0; i!=3000; i++)
+    once[i] = mt_next(&a);
+  mt_init(&b, 42);
+  for (i=n=0; n!=3000; n += i, i = i*2 + 1 < 3000 - n ? i*2 + 1 : 3000 - n)
+    mt_fill32(&b, chunked + n, i);
+  assert(!memcmp(once, chunked, sizeof(once)));
+
+  /* bytes come four per word, least significant first */
+  memcpy(&y, seed, 4);
+  frng((char*) bytes, seed, sizeof(bytes));
+  mt_init(&a, y);
+  for (i=0; i!=sizeof(bytes); i++) {
+    if (i % 4 == 0) y = mt_next(&a);
+    assert(bytes[i] == (y >> 8*(i%4) & 0xff));
+  }
+}
+
+static void* draw(void* arg)
+{
+  struct mt_ctx ctx;
+  uint32_t* out = arg;
+
+  mt_init(&ctx, 7);
+  mt_fill32(&ctx, out, 5000);
+  return NULL;
+}
+
+/* contexts are independent: threads drawing at once get the same streams */
+void test_threads(void)
+{
+  static uint32_t out[4][5000];
+  pthread_t tid[4];
+  size_t t;
+
+  for (t=0; t!=4; t++)
+    pthread_create(&tid[t], NULL, draw, out[t]);
+  for (t=0; t!=4; t++)
+    pthread_join(tid[t], NULL);
+  for (t=1; t!=4; t++)
+    assert(!memcmp(out[0], out[t], sizeof(out[0])));
+}
+
+/* jumping 2^k outputs ahead is the same as drawing them */
+void test_jump(void)
+{
+  static const unsigned ks[] = {0, 5, 10, 16, 12};
+  struct mt_ctx a, b, subs[3];
+  size_t i, t;
+
+  mt_init(&a, 99);
+  mt_init(&b, 99);
+  for (t=0; t!=sizeof(ks)/sizeof(ks[0]); t++) {
+    /* from anywhere in the state */
+    for (i=0; i!=100 + 37*t; i++)
+      assert(mt_next(&a) == mt_next(&b));
+    mt_jump(&a, ks[t]);
+    for (i=0; i!=(size_t) 1 << ks[t]; i++)
+      mt_next(&b);
+    for (i=0; i!=1000; i++)
+      assert(mt_next(&a) == mt_next(&b));
+  }
+
+  mt_substreams(subs, 3, 7, 11);
+  mt_init(&a, 7);
+  for (t=0; t!=3; t++)
+    for (i=0; i!=1 << 11; i++)
+      assert(mt_next(&subs[t]) == mt_next(&a));
+}
+
+int main(int argc, char** argv)
+{
+  test_reference();
+  test_fill();
+  test_threads();
+  test_jump();
+  return 0;
+}
@@ -0,0 +1,69 @@
+#include <assert.h>
+#include <openssl/bn.h>
+
+#include "pool.h"
+#include "rsa.h"
+
+void test_tokens(void)
+{
+  struct pool* p = pool_new(16, 8, 2);
+  BIGNUM *t = NULL, *u = NULL;
+  size_t i;
+
+  pool_wait(p);
+  /* past the reservoir, tokens come inline */
+  for (i=0; i!=20; i++) {
+    pool_token(p, &t, 16);
+    assert(!BN_is_zero(t) && !BN_is_one(t));
+    pool_token(NULL, &u, 16);
+    assert(!BN_is_zero(u) && !BN_is_one(u));
+  }
+  /* and the reservoir is topped up again */
+  pool_wait(p);
+  pool_free(p);
+  BN_free(t);
+  BN_free(u);
+}
+
+void test_challenges(void)
+{
+  struct pool* p = pool_new(16, 4, 3);
+  BIGNUM *e = NULL, *n = NULL, *r = NULL, *c = NULL, *check = BN_new();
+  BN_CTX* ctx = BN_CTX_new();
+  size_t i, pooled;
+
+  BN_hex2bn(&n, "79F874B5F8BABE85");
+  BN_hex2bn(&e, "10003");
+  assert(pool_add_client(p, "Pippo", e, n));
+  pool_wait(p);
+
+  for (i=pooled=0; i!=10; i++) {
+    pooled += pool_challenge(p, "Pippo", 16, e, n, &r, &c);
+    BN_mod_exp(check, r, e, n, ctx);
+    assert(!BN_cmp(check, c));
+  }
+  assert(pooled >= 4);
+
+  /* unknown clients, other keys and sizes, and no pool, are served inline */
+  assert(!pool_challenge(p, "Pluto", 16, e, n, &r, &c));
+  assert(!pool_challenge(p, "Pippo", 16, n, n, &r, &c));
+  assert(!pool_challenge(p, "Pippo", 32, e, n, &r, &c));
+  assert(!pool_challenge(NULL, "Pippo", 16, e, n, &r, &c));
+  BN_mod_exp(check, r, e, n, ctx);
+  assert(!BN_cmp(check, c));
+
+  pool_free(p);
+  BN_CTX_free(ctx);
+  BN_free(check);
+  BN_free(e);
+  BN_free(n);
+  BN_free(r);
+  BN_free(c);
+}
+
+int main(int argc, char** argv)
+{
+  test_tokens();
+  test_challenges();
+  return 0;
+}
@@ -8,18 +8,41 @@
 
 void test_prng(void)
 {
-  BIGNUM* a;
+  BIGNUM* a = NULL;
   prng(&a, 128);
   assert(BN_is_prime(a, 10, NULL, NULL, NULL));
   prng(&a, 256);
   assert(BN_is_prime(a, 10, NULL, NULL, NULL));
   prng(&a, 512);
   assert(BN_is_prime(a, 10, NULL, NULL, NULL));
+  BN_free(a);
+}
+
+void test_safe_prng(void)
+{
+  BIGNUM *p = NULL, *q = BN_new();
+  int threads, bits;
+
+  for (threads=1; threads<=4; threads++) {
+    safe_prng(&p, 128, threads);
+    BN_rshift1(q, p);
+    assert(BN_num_bits(p) == 128);
+    assert(BN_is_prime(p, 10, NULL, NULL, NULL));
+    assert(BN_is_prime(q, 10, NULL, NULL, NULL));
+  }
+  /* small ones are exactly as wide too, rather than past the top */
+  for (bits=6; bits<=24; bits++) {
+    safe_prng(&p, bits, 1);
+    assert(BN_num_bits(p) == bits);
+  }
+  BN_free(p);
+  BN_free(q);
 }
 
 
 int main(int argc, char **argv)
 {
   test_prng();
+  test_safe_prng();
   return 0;
 }
@@ -0,0 +1,558 @@
+/**
+ * \file linalg.c
+ *
+ * Linear algebra over 𝔽₂ applied to the ciphers of the library:
+ *
+ * + keyload: key loading as a linear map, and its inversion;
+ * + all5: recovery of an ALL5 key from its keystream alone, linearising the
+ *   1254 products of register bits the combining function is made of;
+ * + lfsr: recovery of the other ALL5 registers once x2 and x4 are known, as
+ *   from corrattack, and of the key;
+ * + mixing: structure of the mixing layer of Bunny24, a 24 × 24 binary matrix;
+ * + bench: products and eliminations on random matrices.
+ *
+ * Keys are random, from the seed given with -s: the same as in corrattack.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bitmatrix.h"
+#include "bm.h"
+#include "bunny24.h"
+#include "lfsr.h"
+
+/* register states, one after the other: 19 + 22 + 23 + 11 + 13 bits */
+#define STATE_BITS 88
+
+
+void usage(void)
+{
+  fprintf(stderr,
+          "Usage: ./linalg keyload [-s seed]\n"
+          "       ./linalg all5 [-s seed] [-e extra equations]\n"
+          "       ./linalg lfsr [-s seed] [x2 x4]\n"
+          "       ./linalg mixing\n"
+          "       ./linalg bench [n]\n");
+  exit(EXIT_FAILURE);
+}
+
+static double elapsed(const struct timespec* start)
+{
+  struct timespec end;
+
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/** Parses -s seed, and -e extra where extra is not NULL. */
+static unsigned options(int argc, char** argv, size_t* extra)
+{
+  unsigned seed = 1;
+  int opt;
+
+  while ((opt = getopt(argc, argv, extra ? "s:e:" : "s:")) != -1)
+    switch (opt) {
+    case 's': seed = strtoul(optarg, NULL, 0); break;
+    case 'e': *extra = strtoul(optarg, NULL, 0); break;
+    default: usage();
+    }
+  return seed;
+}
+
+/** The key corrattack draws from the same seed. */
+static char* random_key(char* key, unsigned seed)
+{
+  size_t i;
+
+  srand(seed);
+  for (i=0; i!=64; i++)
+    key[i] = rand() & 1;
+  return key;
+}
+
+static size_t offset(size_t j)
+{
+  size_t off, i;
+
+  for (off=i=0; i!=j; i++)
+    off += lfsr_degree(i);
+  return off;
+}
+
+/** Packs the states of the first n registers one after the other. */
+static uint64_t* pack_states(uint64_t* dest, const uint64_t* states, size_t n)
+{
+  size_t j, b;
+
+  memset(dest, 0, (STATE_BITS/64 + 1) * sizeof(uint64_t));
+  for (j=0; j!=n; j++)
+    for (b=0; b!=lfsr_degree(j); b++)
+      dest[(offset(j)+b)/64] |= (states[j] >> b & 1) << ((offset(j)+b)%64);
+  return dest;
+}
+
+static void print_states(const uint64_t* states, const uint64_t* actual)
+{
+  size_t j;
+
+  for (j=0; j!=5; j++)
+    printf("      x%zu = %#0*lx %s\n", j+1, (int) (lfsr_degree(j)+3)/4 + 2,
+           (unsigned long) states[j],
+           states[j] == actual[j] ? "(correct)" : "(wrong)");
+}
+
+
+/*
+ * +-------------+
+ * | Key Loading |
+ * +-------------+
+ */
+
+/** Register states from a key: after key loading, or after the warm-up too. */
+static uint64_t* key_states(uint64_t* dest, const char* key, int warm)
+{
+  struct all5_ctx ctx;
+  uint64_t states[5];
+
+  if (warm) return pack_states(dest, all5_init(&ctx, key)->states, 5);
+  lfsr_key_loading(states, key, 1);
+  return pack_states(dest, states, 5);
+}
+
+/**
+ * \brief The key loading of the first n registers as an affine map,
+ * states = m·key + c.
+ *
+ * \param warm if non-zero, the regular warm-up of ALL5 is included.
+ */
+static struct gf2matrix* key_map(uint64_t* c, size_t n, int warm)
+{
+  struct gf2matrix* m;
+  char key[64];
+  uint64_t v[STATE_BITS/64 + 1];
+  size_t i, k;
+
+  m = gf2m_new(offset(n), 64);
+  memset(key, 0, sizeof(key));
+  key_states(c, key, warm);
+  for (k=0; k!=64; k++) {
+    key[k] = 1;
+    key_states(v, key, warm);
+    key[k] = 0;
+    for (i=0; i!=offset(n); i++)
+      gf2m_set(m, i, k, (v[i/64] ^ c[i/64]) >> (i%64) & 1);
+  }
+  return m;
+}
+
+/**
+ * \brief Recovers the key from the register states at the start of the ALL5
+ * keystream.
+ *
+ * \return the dimension of the space of keys leading to those states, -1 if
+ *         there is none.
+ */
+static long invert_key(char* key, const uint64_t* states)
+{
+  struct gf2matrix* m;
+  uint64_t c[STATE_BITS/64 + 1], v[STATE_BITS/64 + 1], x[2];
+  size_t i;
+  long dim;
+
+  m = key_map(c, 5, 1);
+  pack_states(v, states, 5);
+  for (i=0; i!=STATE_BITS/64 + 1; i++)
+    v[i] ^= c[i];
+  dim = gf2m_solve(x, m, v);
+  for (i=0; i!=64; i++)
+    key[i] = x[0] >> i & 1;
+
+  gf2m_free(m);
+  return dim;
+}
+
+static void print_key(const char* key, const char* actual)
+{
+  size_t i, b;
+  unsigned char byte;
+
+  printf("[+] key: ");
+  for (i=0; i!=8; i++) {
+    for (byte=b=0; b!=8; b++)
+      byte |= key[8*i + b] << b;
+    printf("%02x", byte);
+  }
+  printf(" %s\n", memcmp(key, actual, 64) ? "(wrong)" : "(correct)");
+}
+
+static int keyload(int argc, char** argv)
+{
+  static const char* names[] = {"A5/1 loading", "ALL5 loading", "ALL5 warm-up"};
+  struct gf2matrix* m;
+  struct timespec start;
+  struct all5_ctx ctx;
+  uint64_t c[STATE_BITS/64 + 1];
+  char key[64], found[64];
+  size_t v;
+  long dim;
+  double secs;
+
+  random_key(key, options(argc, argv, NULL));
+  if (optind != argc) usage();
+  for (v=0; v!=3; v++) {
+    m = key_map(c, v ? 5 : 3, v == 2);
+    printf("[+] %s: %zu × 64, rank %zu\n", names[v], m->rows, gf2m_rank(m));
+    gf2m_free(m);
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  dim = invert_key(found, all5_init(&ctx, key)->states);
+  secs = elapsed(&start);
+  printf("[+] key from the states after the warm-up: %ld solutions, %.3f ms\n",
+         dim < 0 ? 0 : 1L << dim, secs * 1e3);
+  print_key(found, key);
+  return EXIT_SUCCESS;
+}
+
+
+/*
+ * +--------------------+
+ * | ALL5 Linearisation |
+ * +--------------------+
+ */
+
+/* the monomials of f = x1x4 + x2x3 + x2x5 + x3x4 */
+static const size_t pairs[4][2] = {{0, 3}, {1, 2}, {1, 4}, {2, 3}};
+
+/**
+ * \brief Output sequences of the unit states of each register.
+ *
+ * Row offset(j) + i holds n outputs of register j from the state with just
+ * bit i set.
+ */
+static struct gf2matrix* unit_outputs(size_t n)
+{
+  struct gf2matrix* u;
+  uint64_t* seq;
+  size_t j, i;
+
+  u = gf2m_new(STATE_BITS, n);
+  seq = malloc((n/64 + 1) * sizeof(uint64_t));
+  for (j=0; j!=5; j++)
+    for (i=0; i!=lfsr_degree(j); i++) {
+      lfsr_output(seq, j, (uint64_t) 1 << i, n);
+      memcpy(gf2m_row(u, offset(j)+i), seq, (n+63)/64 * sizeof(uint64_t));
+    }
+  free(seq);
+  return u;
+}
+
+/**
+ * \brief Reads the states of two registers back from their products.
+ *
+ * y holds yᵢⱼ = aᵢ·bⱼ in bit i·deg(b) + j: any yᵢⱼ = 1 gives aᵢ = bⱼ = 1, then
+ * a is column j and b row i.
+ */
+static int factor(uint64_t* a, uint64_t* b, const uint64_t* y, size_t da, size_t db)
+{
+  size_t i, j, k, n;
+
+  for (n=0; n!=da*db && !(y[n/64] >> (n%64) & 1); n++) ;
+  if (n == da*db) return 0;
+  i = n / db;
+  j = n % db;
+  for (*a=*b=k=0; k!=da; k++)
+    *a |= (y[(k*db + j)/64] >> ((k*db + j)%64) & 1) << k;
+  for (k=0; k!=db; k++)
+    *b |= (y[(i*db + k)/64] >> ((i*db + k)%64) & 1) << k;
+  return 1;
+}
+
+static int linearise(int argc, char** argv)
+{
+  struct gf2matrix *u, *a;
+  struct timespec start;
+  struct all5_ctx ctx;
+  char key[64], found[64];
+  char* bits;
+  uint64_t *z, *y, *row;
+  uint64_t states[5], ya[8];
+  size_t off[4], unknowns, n, extra, t, p, i, j, k, da, db;
+  long dim;
+  int ok;
+  double building, solving;
+
+  extra = 64;
+  random_key(key, options(argc, argv, &extra));
+  if (optind != argc) usage();
+
+  for (unknowns=p=0; p!=4; p++) {
+    off[p] = unknowns;
+    unknowns += lfsr_degree(pairs[p][0]) * lfsr_degree(pairs[p][1]);
+  }
+  n = unknowns + extra;
+  printf("[+] %zu monomials, %zu keystream bits\n", unknowns, n);
+
+  bits = malloc(n);
+  z = malloc((n/64 + 1) * sizeof(uint64_t));
+  y = malloc((unknowns/64 + 1) * sizeof(uint64_t));
+  all5(bits, key, n);
+  pack_bits(z, bits, n);
+
+  /* keystream bit t: Σ over the monomials of (uₜ·a)(vₜ·b) = Σᵢⱼ uₜᵢvₜⱼ·aᵢbⱼ */
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  u = unit_outputs(n);
+  a = gf2m_new(n, unknowns);
+  for (t=0; t!=n; t++) {
+    row = gf2m_row(a, t);
+    for (p=0; p!=4; p++)
+      for (i=0; i!=lfsr_degree(pairs[p][0]); i++) {
+        if (!gf2m_get(u, offset(pairs[p][0]) + i, t)) continue;
+        for (j=0; j!=lfsr_degree(pairs[p][1]); j++)
+          if (gf2m_get(u, offset(pairs[p][1]) + j, t))
+            row[(off[p] + i*lfsr_degree(pairs[p][1]) + j)/64] |=
+              (uint64_t) 1 << ((off[p] + i*lfsr_degree(pairs[p][1]) + j)%64);
+      }
+  }
+  building = elapsed(&start);
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  dim = gf2m_solve(y, a, z);
+  solving = elapsed(&start);
+  printf("[+] system %zu × %zu: %ld-dimensional space of solutions\n",
+         a->rows, a->cols, dim);
+  printf("[+] building %.3f s, solving %.3f s\n", building, solving);
+
+  /* each register appears in some monomial */
+  memset(states, 0, sizeof(states));
+  for (ok=1, p=0; p!=4; p++) {
+    da = lfsr_degree(pairs[p][0]);
+    db = lfsr_degree(pairs[p][1]);
+    memset(ya, 0, sizeof(ya));
+    for (k=0; k!=da*db; k++)
+      ya[k/64] |= (y[(off[p]+k)/64] >> ((off[p]+k)%64) & 1) << (k%64);
+    ok &= factor(&states[pairs[p][0]], &states[pairs[p][1]], ya, da, db);
+  }
+
+  if (dim < 0 || !ok) printf("[-] no consistent solution\n");
+  else {
+    all5_init(&ctx, key);
+    print_states(states, ctx.states);
+    invert_key(found, states);
+    print_key(found, key);
+  }
+
+  gf2m_free(u);
+  gf2m_free(a);
+  free(bits);
+  free(z);
+  free(y);
+  return EXIT_SUCCESS;
+}
+
+
+/*
+ * +----------------------+
+ * | ALL5 State Recovery  |
+ * +----------------------+
+ */
+
+/*
+ * With x2 and x4 known, f = x1·x4 + x3·(x2 + x4) + x5·x2 is linear in the
+ * other registers: 19 + 23 + 13 = 55 unknowns, one equation per step with x2
+ * or x4 set.
+ */
+static const size_t unknown[3] = {0, 2, 4};
+
+static int recover(int argc, char** argv)
+{
+  struct gf2matrix *u, *a;
+  struct timespec start;
+  struct all5_ctx ctx;
+  char key[64], found[64];
+  char bits[512];
+  uint64_t z[512/64 + 1], rhs[512/64 + 1], x[2];
+  uint64_t states[5];
+  uint64_t seq2[512/64 + 1], seq4[512/64 + 1];
+  size_t n, t, r, j, i, col;
+  int b2, b4, coef;
+  long dim;
+  double secs;
+
+  random_key(key, options(argc, argv, NULL));
+  all5_init(&ctx, key);
+  memcpy(states, ctx.states, sizeof(states));
+  if (argc - optind == 2) {
+    states[1] = strtoull(argv[optind], NULL, 16);
+    states[3] = strtoull(argv[optind+1], NULL, 16);
+  } else if (argc != optind) usage();
+
+  n = sizeof(bits);
+  all5(bits, key, n);
+  pack_bits(z, bits, n);
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  u = unit_outputs(n);
+  lfsr_output(seq2, 1, states[1], n);
+  lfsr_output(seq4, 3, states[3], n);
+  for (r=t=0; t!=n; t++)
+    r += ((seq2[t/64] | seq4[t/64]) >> (t%64) & 1);
+  a = gf2m_new(r, offset(5) - lfsr_degree(1) - lfsr_degree(3));
+  memset(rhs, 0, sizeof(rhs));
+  for (r=t=0; t!=n; t++) {
+    b2 = seq2[t/64] >> (t%64) & 1;
+    b4 = seq4[t/64] >> (t%64) & 1;
+    if (!b2 && !b4) continue;
+    for (col=j=0; j!=3; col += lfsr_degree(unknown[j++])) {
+      coef = unknown[j] == 0 ? b4 : unknown[j] == 2 ? b2 ^ b4 : b2;
+      if (coef)
+        for (i=0; i!=lfsr_degree(unknown[j]); i++)
+          gf2m_set(a, r, col + i, gf2m_get(u, offset(unknown[j]) + i, t));
+    }
+    rhs[r/64] |= (z[t/64] >> (t%64) & 1) << (r%64);
+    r++;
+  }
+
+  dim = gf2m_solve(x, a, rhs);
+  secs = elapsed(&start);
+  printf("[+] %zu equations in %zu unknowns: %ld-dimensional space of solutions, %.3f ms\n",
+         a->rows, a->cols, dim, secs * 1e3);
+  if (dim < 0) {
+    printf("[-] no solution: wrong x2 or x4\n");
+  } else {
+    for (col=j=0; j!=3; col += lfsr_degree(unknown[j++]))
+      for (states[unknown[j]]=i=0; i!=lfsr_degree(unknown[j]); i++)
+        states[unknown[j]] |= (x[(col+i)/64] >> ((col+i)%64) & 1) << i;
+    print_states(states, ctx.states);
+    invert_key(found, states);
+    print_key(found, key);
+  }
+
+  gf2m_free(u);
+  gf2m_free(a);
+  return dim < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+
+/*
+ * +----------------------+
+ * | Bunny24 Mixing Layer |
+ * +----------------------+
+ */
+
+/* bit 6i + b of a block is bit b of its i-th 6-bit word */
+static struct gf2matrix* layer_matrix(int8* (*layer)(int8*, int8*))
+{
+  struct gf2matrix* m;
+  int8 v[4], w[4];
+  size_t i, k;
+
+  m = gf2m_new(24, 24);
+  for (k=0; k!=24; k++) {
+    memset(v, 0, sizeof(v));
+    v[k/6] = 1 << (k%6);
+    layer(w, v);
+    for (i=0; i!=24; i++)
+      gf2m_set(m, i, k, w[i/6] >> (i%6) & 1);
+  }
+  return m;
+}
+
+static int mixing(int argc, char** argv)
+{
+  struct gf2matrix *m, *inv, *expected, *p, *q, *id, *tmp;
+  size_t i;
+  unsigned long order;
+
+  m = layer_matrix(mixing_layer);
+  expected = layer_matrix(inverse_mixing_layer);
+  inv = gf2m_new(24, 24);
+  id = gf2m_identity(24);
+
+  printf("[+] mixing layer: 24 × 24, rank %zu\n", gf2m_rank(m));
+  printf("[+] inverse %s inverse_mixing_layer()\n",
+         gf2m_inverse(inv, m) && gf2m_equal(inv, expected) ? "matches" : "DOES NOT match");
+
+  /* fixed points: the kernel of M + I */
+  p = gf2m_copy(m);
+  for (i=0; i!=24; i++)
+    gf2m_set(p, i, i, !gf2m_get(p, i, i));
+  printf("[+] %lu fixed points\n", 1UL << (24 - gf2m_rank(p)));
+
+  /* order: the least e with Mᵉ = I, at most 2²⁴ - 1 */
+  gf2m_free(p);
+  p = gf2m_copy(m);
+  q = gf2m_new(24, 24);
+  for (order=1; !gf2m_equal(p, id) && order != 1UL << 24; order++) {
+    gf2m_mul(q, p, m);
+    tmp = p; p = q; q = tmp;
+  }
+  printf("[+] order %lu\n", order);
+
+  gf2m_free(m);
+  gf2m_free(expected);
+  gf2m_free(inv);
+  gf2m_free(id);
+  gf2m_free(p);
+  gf2m_free(q);
+  return EXIT_SUCCESS;
+}
+
+
+/*
+ * +-----------+
+ * | Benchmark |
+ * +-----------+
+ */
+
+static int bench(int argc, char** argv)
+{
+  struct gf2matrix *a, *b, *c;
+  struct timespec start;
+  size_t n, r;
+  double secs;
+
+  n = argc > 2 ? strtoul(argv[2], NULL, 0) : 10000;
+  if (!n) usage();
+  srand(1);
+  a = gf2m_random(n, n);
+  b = gf2m_random(n, n);
+  c = gf2m_new(n, n);
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  gf2m_mul(c, a, b);
+  secs = elapsed(&start);
+  printf("[+] %zu × %zu product: %.3f s\n", n, n, secs);
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  r = gf2m_echelon(c, 0);
+  secs = elapsed(&start);
+  printf("[+] %zu × %zu echelon form, rank %zu: %.3f s\n", n, n, r, secs);
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  r = gf2m_echelon(a, 1);
+  secs = elapsed(&start);
+  printf("[+] %zu × %zu reduced echelon form, rank %zu: %.3f s\n", n, n, r, secs);
+
+  gf2m_free(a);
+  gf2m_free(b);
+  gf2m_free(c);
+  return EXIT_SUCCESS;
+}
+
+
+int main(int argc, char** argv)
+{
+  if (argc < 2) usage();
+  if (!strcmp(argv[1], "keyload")) return keyload(argc - 1, argv + 1);
+  if (!strcmp(argv[1], "all5")) return linearise(argc - 1, argv + 1);
+  if (!strcmp(argv[1], "lfsr")) return recover(argc - 1, argv + 1);
+  if (!strcmp(argv[1], "mixing")) return mixing(argc, argv);
+  if (!strcmp(argv[1], "bench")) return bench(argc, argv);
+  usage();
+  return EXIT_FAILURE;
+}
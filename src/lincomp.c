@@ -0,0 +1,117 @@
+/**
+ * \file lincomp.c
+ *
+ * Linear complexity analysis of the keystream generators: computes the
+ * linear complexity and its profile over the first n bits of the output of
+ * \ref maj5(), \ref all5(), \ref a5_1(), \ref frng() or \ref srng().
+ *
+ * A random sequence has linear complexity close to n/2, with the profile
+ * following (N+1)/2 closely.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bm.h"
+#include "lfsr.h"
+#include "rng.h"
+
+
+void usage(void)
+{
+  fprintf(stderr,
+          "Usage: ./lincomp [-s seed] [-p points] <generator> <bits>\n"
+          "  generator: maj5, all5, a5_1, frng, srng\n");
+  exit(EXIT_FAILURE);
+}
+
+
+/**
+ * \brief Produces n bits of keystream, one per byte.
+ *
+ * Byte-oriented generators are split into bits, least significant first.
+ */
+static char* keystream(char* dest, const char* generator, unsigned seed, size_t n)
+{
+  char key[64];
+  char iseed[4];
+  char* bytes;
+  size_t i;
+
+  srand(seed);
+  for (i=0; i!=64; i++)
+    key[i] = rand() & 1;
+  for (i=0; i!=4; i++)
+    iseed[i] = rand();
+
+  if (!strcmp(generator, "maj5")) return maj5(dest, key, n);
+  if (!strcmp(generator, "all5")) return all5(dest, key, n);
+  if (!strcmp(generator, "a5_1")) return a5_1(dest, key, n);
+
+  bytes = malloc(n/8 + 1);
+  if (!strcmp(generator, "frng")) frng(bytes, iseed, n/8 + 1);
+  else if (!strcmp(generator, "srng")) srng(bytes, iseed, n/8 + 1);
+  else usage();
+  for (i=0; i!=n; i++)
+    dest[i] = bytes[i/8] >> (i%8) & 1;
+
+  free(bytes);
+  return dest;
+}
+
+
+int main(int argc, char** argv)
+{
+  struct timespec start, end;
+  char* bits;
+  uint64_t* packed;
+  size_t *profile, n, i, L, dev, maxdev;
+  unsigned seed;
+  int opt, points;
+  double elapsed;
+
+  seed = 1;
+  points = 10;
+  while ((opt = getopt(argc, argv, "s:p:")) != -1)
+    switch (opt) {
+    case 's': seed = strtoul(optarg, NULL, 0); break;
+    case 'p': points = atoi(optarg); break;
+    default: usage();
+    }
+  if (argc - optind != 2) usage();
+  n = strtoull(argv[optind+1], NULL, 0);
+  if (!n || points < 1) usage();
+
+  bits = malloc(n);
+  packed = malloc((n/64 + 1) * sizeof(uint64_t));
+  profile = malloc(n * sizeof(size_t));
+  keystream(bits, argv[optind], seed, n);
+  pack_bits(packed, bits, n);
+  free(bits);
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  L = linear_complexity(packed, n, profile);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+  printf("[+] %s, %zu bits: linear complexity %zu (n/2 = %zu)\n",
+         argv[optind], n, L, n/2);
+  printf("[+] profile:\n");
+  for (i=1; i<=(size_t) points; i++)
+    printf("  %12zu %12zu\n", n*i/points, profile[n*i/points - 1]);
+
+  /* largest distance from the expected (N+1)/2 */
+  for (i=maxdev=0; i!=n; i++) {
+    dev = profile[i] > (i+1)/2 ? profile[i] - (i+1)/2 : (i+1)/2 - profile[i];
+    if (dev > maxdev) maxdev = dev;
+  }
+  printf("[+] max deviation from (N+1)/2: %zu\n", maxdev);
+  fprintf(stderr, "[+] %.3f s\n", elapsed);
+
+  free(packed);
+  free(profile);
+  return 0;
+}
@@ -0,0 +1,244 @@
+/**
+ * \file polysearch.c
+ *
+ * Search for primitive polynomials, to be used as feedback polynomials for
+ * the registers of \ref maj5(), \ref all5() and \ref a5_1().
+ *
+ * Either enumerates all the polynomials of a given degree, or all the
+ * trinomials and pentanomials of degree up to 64, splitting the candidates
+ * among worker threads.
+ */
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "field.h"
+
+#define MAX_DEGREE 64
+#define BATCH (1 << 16)
+#define CHUNK 256
+
+
+struct search {
+  f2poly candidates[BATCH];
+  char primitive[BATCH];
+  size_t n;
+  size_t next;
+};
+
+struct stats {
+  uint64_t candidates;
+  uint64_t irreducible;
+  uint64_t primitive;
+  /* primitive polynomials, per number of taps */
+  uint64_t taps[MAX_DEGREE+1];
+};
+
+
+void usage(void)
+{
+  fprintf(stderr,
+          "Usage: ./polysearch [-j threads] [-n max] <degree>\n"
+          "       ./polysearch [-j threads] -s [max degree]\n");
+  exit(EXIT_FAILURE);
+}
+
+
+static int weight(f2poly p)
+{
+  return __builtin_popcountll((uint64_t) p) + __builtin_popcountll(p >> 64);
+}
+
+/**
+ * \brief Classifies a single candidate.
+ *
+ * \return 2 if `p` is primitive, 1 if it is just irreducible, 0 otherwise.
+ */
+static char classify(f2poly p)
+{
+  /* an even number of terms means that x + 1 divides p */
+  if (!(p & 1) || !(weight(p) & 1)) return 0;
+  if (!f2irreducible(p)) return 0;
+  return 1 + f2primitive(p);
+}
+
+static void* worker(void* arg)
+{
+  struct search* s = arg;
+  size_t i, start;
+
+  while ((start = __atomic_fetch_add(&s->next, CHUNK, __ATOMIC_RELAXED)) < s->n)
+    for (i=start; i!=s->n && i!=start+CHUNK; i++)
+      s->primitive[i] = classify(s->candidates[i]);
+
+  return NULL;
+}
+
+static void run(struct search* s, int threads)
+{
+  pthread_t tid[threads];
+  int t;
+
+  s->next = 0;
+  for (t=0; t!=threads; t++)
+    if (pthread_create(&tid[t], NULL, worker, s)) abort();
+  for (t=0; t!=threads; t++)
+    pthread_join(tid[t], NULL);
+}
+
+static void print_poly(f2poly p)
+{
+  int i;
+
+  for (i=f2deg(p); i > 0; i--)
+    if (p >> i & 1) printf("x^%d + ", i);
+  printf("1\n");
+}
+
+/**
+ * \brief Prints the primitive polynomials in the batch, in order.
+ *
+ * Once `left` have been printed, the rest of the batch is dropped, so that
+ * the statistics stop at the last polynomial printed.
+ *
+ * \return the number of primitive polynomials still to be printed.
+ */
+static uint64_t collect(struct search* s, struct stats* st, uint64_t left)
+{
+  size_t i;
+
+  for (i=0; i!=s->n && left; i++) {
+    if (s->primitive[i] >= 1) st->irreducible++;
+    if (s->primitive[i] != 2) continue;
+    st->primitive++;
+    st->taps[weight(s->candidates[i]) - 1]++;
+    print_poly(s->candidates[i]);
+    left--;
+  }
+  st->candidates += i;
+  return left;
+}
+
+static void report(int degree, const struct stats* st)
+{
+  int i;
+
+  fprintf(stderr, "[+] degree %d: %lu candidates, %lu irreducible, %lu primitive\n",
+          degree,
+          (unsigned long) st->candidates,
+          (unsigned long) st->irreducible,
+          (unsigned long) st->primitive);
+  for (i=0; i<=MAX_DEGREE; i++)
+    if (st->taps[i])
+      fprintf(stderr, "      %2d taps: %lu\n", i, (unsigned long) st->taps[i]);
+}
+
+
+/*
+ * +-------------------+
+ * | Search Strategies |
+ * +-------------------+
+ */
+
+/**
+ * \brief All the polynomials of the given degree with constant term 1.
+ *
+ * Stops as soon as `max` primitive polynomials have been found.
+ */
+static void search_dense(struct search* s, int degree, uint64_t max, int threads)
+{
+  struct stats st;
+  uint64_t i, total;
+
+  memset(&st, 0, sizeof(st));
+  total = (uint64_t) 1 << (degree-1);
+  for (i=0; i!=total && st.primitive < max; ) {
+    for (s->n=0; s->n!=BATCH && i!=total; i++)
+      s->candidates[s->n++] = (f2poly) 1 << degree | (f2poly) i << 1 | 1;
+    run(s, threads);
+    collect(s, &st, max - st.primitive);
+  }
+  report(degree, &st);
+}
+
+/**
+ * \brief Trinomials and pentanomials of degree 2 up to `max_degree`.
+ *
+ * Sparse polynomials make for cheap feedback functions, and at least one of
+ * the two kinds exists for every degree up to 64.
+ */
+static void search_sparse(struct search* s, int max_degree, int threads)
+{
+  struct stats st, total;
+  int d, a, b, c;
+  f2poly top;
+
+  memset(&total, 0, sizeof(total));
+  for (d=2; d<=max_degree; d++) {
+    memset(&st, 0, sizeof(st));
+    top = (f2poly) 1 << d | 1;
+    s->n = 0;
+    for (a=1; a!=d; a++)
+      s->candidates[s->n++] = top | (f2poly) 1 << a;
+    for (a=3; a<d; a++)
+      for (b=2; b<a; b++)
+        for (c=1; c<b; c++)
+          s->candidates[s->n++] = top | (f2poly) 1 << a | (f2poly) 1 << b | (f2poly) 1 << c;
+    run(s, threads);
+    collect(s, &st, UINT64_MAX);
+
+    report(d, &st);
+    total.candidates += st.candidates;
+    total.irreducible += st.irreducible;
+    total.primitive += st.primitive;
+    for (a=0; a<=MAX_DEGREE; a++)
+      total.taps[a] += st.taps[a];
+  }
+
+  fprintf(stderr, "[+] total: %lu candidates, %lu primitive (%lu trinomials, %lu pentanomials)\n",
+          (unsigned long) total.candidates,
+          (unsigned long) total.primitive,
+          (unsigned long) total.taps[2],
+          (unsigned long) total.taps[4]);
+}
+
+
+int main(int argc, char** argv)
+{
+  struct search* s;
+  struct timespec start, end;
+  int opt, threads, sparse, degree;
+  uint64_t max;
+
+  threads = sysconf(_SC_NPROCESSORS_ONLN);
+  sparse = 0;
+  max = UINT64_MAX;
+  while ((opt = getopt(argc, argv, "j:n:s")) != -1)
+    switch (opt) {
+    case 'j': threads = atoi(optarg); break;
+    case 'n': max = strtoull(optarg, NULL, 10); break;
+    case 's': sparse = 1; break;
+    default: usage();
+    }
+  if (threads < 1) threads = 1;
+
+  if (optind < argc) degree = atoi(argv[optind]);
+  else if (sparse) degree = MAX_DEGREE;
+  else usage();
+  if (degree < 2 || degree > MAX_DEGREE) usage();
+
+  s = malloc(sizeof(struct search));
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  if (sparse) search_sparse(s, degree, threads);
+  else search_dense(s, degree, max, threads);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  fprintf(stderr, "[+] %d threads, %.3f s\n", threads,
+          (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9);
+
+  free(s);
+  return 0;
+}
@@ -1,9 +1,12 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #include <openssl/bn.h>
 
 #include "fsock.h"
+#include "pool.h"
 #include "rsa.h"
 #include "rng.h"
 #include "sponge.h"
@@ -53,6 +56,25 @@ static int get_cipher(const char cipher)
   return 0;
 }
 
+/* registers every client of names_file with the pool */
+static void pool_clients(struct pool *pool, const char *names_file)
+{
+  FILE *f;
+  static char sname[129], se[129], sn[129];
+  BIGNUM *e = NULL, *n = NULL;
+
+  if (!pool) return;
+  if (!(f = fopen(names_file, "r"))) sabort();
+  while (fscanf(f, "%128s %128s %128s", sname, sn, se) == 3) {
+    BN_hex2bn(&e, se);
+    BN_hex2bn(&n, sn);
+    pool_add_client(pool, sname, e, n);
+  }
+  fclose(f);
+  BN_free(e);
+  BN_free(n);
+}
+
 
 int main(int argc, char **argv)
 {
@@ -78,11 +100,30 @@ int main(int argc, char **argv)
     *r1 = NULL,
     *k = NULL,
     *h;
+  struct rsa_crt *srv_crt;
+  struct rsa_key_ctx *srv_key, *cli_key = NULL;
   /* ciphersuite */
   char ciphersuite;
   int symm_cipher, hash, asymm_cipher;
   /* final file */
   FILE *message_store;
+  /* pregenerated tokens and challenges, with -p */
+  struct pool *pool = NULL;
+  int opt, capacity = 0, threads = 1;
+
+  while ((opt = getopt(argc, argv, "p:j:")) != -1)
+    switch (opt) {
+    case 'p': capacity = atoi(optarg); break;
+    case 'j': threads = atoi(optarg); break;
+    default:
+      fprintf(stderr, "Usage: ./server [-p pool size [-j threads]]\n");
+      return 1;
+    }
+  if (capacity > 0) {
+    pool = pool_new(RND_TOKEN_SIZE, capacity, threads);
+    pool_clients(pool, CLIENT_NAMES_FILE_RSA64);
+    pool_wait(pool);
+  }
 
   /* open input and output file descriptors */
   screate(rpath);
@@ -93,7 +134,8 @@ int main(int argc, char **argv)
    *  GET private rsa key of S, (s_prk,n) from
    *  "server_folder/server_rsa_private_key.txt"
    */
-  read_bn_pair(SRV_PRIVKEY_FILE, &srv_rsa_n, &srv_rsa_d);
+  read_rsa_key(SRV_PRIVKEY_FILE, &srv_rsa_n, &srv_rsa_d, &srv_crt);
+  if (!(srv_key = rsa_key_new(srv_rsa_d, srv_rsa_n, srv_crt))) sabort();
 
 
   while (1) {
@@ -104,7 +146,7 @@ int main(int argc, char **argv)
     /* READ c from C */
     sread_bn(&c, rfd);
     /* DECRYPT c using (s_prk,n) -> r' = c^s_prk mod n */
-    rsa_decrypt(c, srv_rsa_d, srv_rsa_n);
+    rsa_key_exp(c, srv_key);
     /* SEND r' to C */
     swrite_bn(c, wfd);
 
@@ -121,10 +163,8 @@ int main(int argc, char **argv)
       goto bye;
     }
     /* CREATE a pseudo-random message r */
-    bn_rng(&r, RND_TOKEN_SIZE);
     /* ENCRYPT r using c_puk[i] -> r' = r^c_puk[i] mod n[i] */
-    BN_copy(c, r);
-    rsa_encrypt(c, cli_rsa_e, cli_rsa_n);
+    pool_challenge(pool, cliname, RND_TOKEN_SIZE, cli_rsa_e, cli_rsa_n, &r, &c);
     /* WRITE c to C */
     swrite_bn(c, wfd);
     /* READ r' from C */
@@ -147,11 +187,14 @@ int main(int argc, char **argv)
         !get_client(CLIENT_NAMES_FILE_RSA512, cliname, &cli_rsa_e, &cli_rsa_n)) sabort();
 
     /* CREATE a pseudo-random key */
-    bn_rng(&k, RND_TOKEN_SIZE);
+    pool_token(pool, &k, RND_TOKEN_SIZE);
     BN_bn2bin(k, (unsigned char *) key);
     /* ENCRYPT key */
     h = BN_dup(k);
-    rsa_encrypt(h, cli_rsa_e, cli_rsa_n);
+    /* clients tend to come back: keep the last key loaded */
+    rsa_key_set(&cli_key, cli_rsa_e, cli_rsa_n);
+    if (!cli_key) sabort();
+    rsa_key_exp(h, cli_key);
     /* WRITE h to C */
     swrite_bn(h, wfd);
     /* Encrypt communication */
@@ -181,6 +224,8 @@ int main(int argc, char **argv)
 
   BN_free(srv_rsa_d);
   BN_free(srv_rsa_n);
+  rsa_key_free(srv_key);
+  rsa_key_free(cli_key);
   BN_free(c);
   BN_free(cli_rsa_e);
   BN_free(cli_rsa_n);
@@ -188,6 +233,7 @@ int main(int argc, char **argv)
   BN_free(r1);
   BN_free(k);
   BN_free(h);
+  pool_free(pool);
 
   sclose(rfd);
   sclose(wfd);